@@ -0,0 +1,113 @@
+//
+//  CueProfile.hpp
+//  Croziers Paradox
+//
+//  Copyright © 2024 Lakshya Chauhan. All rights reserved.
+//  -> Defines the cue profile type of workers and nests
+//  -> Number of cues can be fixed at compile time with -DCUE_COUNT=<iNumCues>
+//  -> Also defines the row view used by the structure of arrays worker layout (Workers.hpp)
+//  Pt 2.4
+
+#ifndef CueProfile_hpp
+#define CueProfile_hpp
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+// Cue profile of K cues stored inline in a std::array, so workers need no separate
+// allocation for their cues and loops over cues have a trip count known to the compiler
+// Any other number of cues is kept in a std::vector as CueProfile<0> does, so a program
+// compiled for one iNumCues still runs others, at the speed of the dynamic profile
+// K = 0 is the dynamic fallback below, holding any number of cues in a std::vector
+template <size_t K>
+class CueProfile {
+public:
+    static constexpr size_t width = K;                  // Compile time number of cues, 0 if dynamic
+
+    CueProfile() : cues{} {}
+
+    // Profile of n cues set to 0 (n > 0)
+    explicit CueProfile(const size_t n) : cues{}, spill(n == K ? 0 : n, 0.0) {}
+
+    explicit CueProfile(const std::vector<double>& values) : CueProfile(values.size()) {
+        std::copy(values.begin(), values.end(), begin());
+    }
+
+    size_t size() const { return spill.empty() ? K : spill.size(); }
+    double& operator[](const size_t i) { return data()[i]; }
+    const double& operator[](const size_t i) const { return data()[i]; }
+    double* data() { return spill.empty() ? cues.data() : spill.data(); }
+    const double* data() const { return spill.empty() ? cues.data() : spill.data(); }
+    double* begin() { return data(); }
+    double* end() { return data() + size(); }
+    const double* begin() const { return data(); }
+    const double* end() const { return data() + size(); }
+
+    // Copy as vector, used by the output statistics
+    std::vector<double> to_vector() const { return std::vector<double>(begin(), end()); }
+
+private:
+    std::array<double, K> cues;
+    std::vector<double> spill;                          // Cues if their number is not K, empty otherwise
+};
+
+// Dynamic fallback for builds without a fixed number of cues
+template <>
+class CueProfile<0> {
+public:
+    static constexpr size_t width = 0;
+
+    CueProfile() = default;
+    explicit CueProfile(const size_t n) : cues(n, 0.0) {}
+    explicit CueProfile(const std::vector<double>& values) : cues(values) {}
+
+    size_t size() const { return cues.size(); }
+    double& operator[](const size_t i) { return cues[i]; }
+    const double& operator[](const size_t i) const { return cues[i]; }
+    double* data() { return cues.data(); }
+    const double* data() const { return cues.data(); }
+    double* begin() { return cues.data(); }
+    double* end() { return cues.data() + cues.size(); }
+    const double* begin() const { return cues.data(); }
+    const double* end() const { return cues.data() + cues.size(); }
+
+    std::vector<double> to_vector() const { return cues; }
+
+private:
+    std::vector<double> cues;
+};
+
+// Number of cues compiled in, 0 for any number of cues
+// Sweeps over a few iNumCues values can build one program per value, e.g. -DCUE_COUNT=10
+// Such a program runs other iNumCues too, on the dynamic path
+#ifndef CUE_COUNT
+#define CUE_COUNT 0
+#endif
+
+using cue_profile_t = CueProfile<CUE_COUNT>;
+
+// Cues of one worker stored as a row of a [workers x cues] matrix, T is double or const double
+// Same interface as CueProfile, so distance functions and outputs take either
+template <typename T>
+class CueRowView {
+public:
+    static constexpr size_t width = CUE_COUNT;
+
+    CueRowView(T* row, const size_t n) : cues(row), num_cues(n) {}
+
+    size_t size() const { return num_cues; }
+    T& operator[](const size_t i) const { return cues[i]; }
+    T* data() const { return cues; }
+    T* begin() const { return cues; }
+    T* end() const { return cues + num_cues; }
+
+    std::vector<double> to_vector() const { return std::vector<double>(begin(), end()); }
+
+private:
+    T* cues;
+    size_t num_cues;
+};
+
+#endif /* CueProfile_hpp */
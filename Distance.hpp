@@ -0,0 +1,176 @@
+//
+//  Distance.hpp
+//  Croziers Paradox
+//
+//  Copyright © 2024 Lakshya Chauhan. All rights reserved.
+//  -> Defines the Bray Curtis distance kernels behind the recognition models
+//  -> AVX2 and SSE4.2 kernels are picked at runtime from the CPU, with a scalar fallback
+//  -> ProjectMaintenance/OldTestingCodes/TestingDistance.cpp checks them against the original loops
+//  Pt 2.5
+
+#ifndef Distance_hpp
+#define Distance_hpp
+
+#include "CueProfile.hpp"
+#include <vector>
+#include <cstddef>
+#include <stdexcept>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DISTANCE_X86
+#endif
+
+// Sums over the cues of a judging template a (nest mean or own cues) and a judged profile b
+// All three recognition modes only need these, as their asymmetric per cue rules add up to
+//   gestalt:              sum(a) + sum(b)
+//   undesirable-absent:   b < a ? 2b : a + b   ==  min(a, b) + b
+//   desirable-present:    a < b ? 2a : a + b   ==  min(a, b) + a
+// so no compare or blend is needed per cue, only a min
+struct ProfileSums {
+    double shared = 0.0;    // Sum of min(a, b), the cue amount both profiles share
+    double sum_a = 0.0;
+    double sum_b = 0.0;
+};
+
+// Scalar fallback
+ProfileSums profile_sums_scalar(const double* a, const double* b, const size_t n) {
+    ProfileSums sums;
+    for (size_t i = 0; i < n; ++i) {
+        sums.shared += std::min(a[i], b[i]);
+        sums.sum_a += a[i];
+        sums.sum_b += b[i];
+    }
+    return sums;
+}
+
+#ifdef DISTANCE_X86
+// Two cues per step, min_pd(b, a) returns a on ties as std::min(a, b) does
+__attribute__((target("sse4.2")))
+ProfileSums profile_sums_sse42(const double* a, const double* b, const size_t n) {
+    __m128d shared = _mm_setzero_pd();
+    __m128d sum_a = _mm_setzero_pd();
+    __m128d sum_b = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const __m128d va = _mm_loadu_pd(a + i);
+        const __m128d vb = _mm_loadu_pd(b + i);
+        shared = _mm_add_pd(shared, _mm_min_pd(vb, va));
+        sum_a = _mm_add_pd(sum_a, va);
+        sum_b = _mm_add_pd(sum_b, vb);
+    }
+    ProfileSums sums;
+    for (; i < n; ++i) {
+        sums.shared += std::min(a[i], b[i]);
+        sums.sum_a += a[i];
+        sums.sum_b += b[i];
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, shared);
+    sums.shared += lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, sum_a);
+    sums.sum_a += lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, sum_b);
+    sums.sum_b += lanes[0] + lanes[1];
+    return sums;
+}
+
+// Four cues per step
+__attribute__((target("avx2")))
+ProfileSums profile_sums_avx2(const double* a, const double* b, const size_t n) {
+    __m256d shared = _mm256_setzero_pd();
+    __m256d sum_a = _mm256_setzero_pd();
+    __m256d sum_b = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d va = _mm256_loadu_pd(a + i);
+        const __m256d vb = _mm256_loadu_pd(b + i);
+        shared = _mm256_add_pd(shared, _mm256_min_pd(vb, va));
+        sum_a = _mm256_add_pd(sum_a, va);
+        sum_b = _mm256_add_pd(sum_b, vb);
+    }
+    // Tail stays inline: calling the SSE or scalar kernels from here would mix legacy SSE
+    // and AVX encodings, whose state transitions cost far more than the kernel itself
+    ProfileSums sums;
+    for (; i < n; ++i) {
+        sums.shared += std::min(a[i], b[i]);
+        sums.sum_a += a[i];
+        sums.sum_b += b[i];
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, shared);
+    sums.shared += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm256_storeu_pd(lanes, sum_a);
+    sums.sum_a += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm256_storeu_pd(lanes, sum_b);
+    sums.sum_b += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    return sums;
+}
+#endif
+
+using ProfileSumsKernel = ProfileSums (*)(const double*, const double*, size_t);
+
+// Best kernel the CPU running the program supports
+ProfileSumsKernel select_profile_sums() {
+#ifdef DISTANCE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return profile_sums_avx2;
+    if (__builtin_cpu_supports("sse4.2")) return profile_sums_sse42;
+#endif
+    return profile_sums_scalar;
+}
+
+// Sums of profiles a and b (CueProfile or CueRowView), fixed width profiles use a fully
+// unrolled loop that is inlined into the caller, dynamic ones and fixed width profiles
+// holding another number of cues go through the kernel picked on first use
+template <typename A, typename B>
+ProfileSums profile_sums(const A& a, const B& b) {
+    static_assert(A::width == B::width, "Profiles of different widths");
+    constexpr size_t K = A::width;
+    if constexpr (K > 0) {
+        if (a.size() == K) {
+            const double* pa = a.data();
+            const double* pb = b.data();
+            ProfileSums sums;
+#pragma GCC unroll 64
+            for (size_t i = 0; i < K; ++i) {
+                sums.shared += std::min(pa[i], pb[i]);
+                sums.sum_a += pa[i];
+                sums.sum_b += pb[i];
+            }
+            return sums;
+        }
+    }
+    static const ProfileSumsKernel kernel = select_profile_sums();
+    return kernel(a.data(), b.data(), a.size());
+}
+
+// Bray Curtis distance from the shared amount and the total of both profiles
+double bray_curtis(const double shared, const double total) {
+    if (total > 0) {
+        return 1.0 - (2.0 * shared / total);
+    }
+    throw std::runtime_error("Sum of profile elements is zero");
+}
+
+// Distances of the three recognition modes, template first and judged profile second
+template <typename A, typename B>
+double gestalt_distance(const A& a, const B& b) {
+    const ProfileSums sums = profile_sums(a, b);
+    return bray_curtis(sums.shared, sums.sum_a + sums.sum_b);
+}
+
+template <typename A, typename B>
+double uabsent_distance(const A& a, const B& b) {
+    const ProfileSums sums = profile_sums(a, b);
+    return bray_curtis(sums.shared, sums.shared + sums.sum_b);
+}
+
+template <typename A, typename B>
+double dpresent_distance(const A& a, const B& b) {
+    const ProfileSums sums = profile_sums(a, b);
+    return bray_curtis(sums.shared, sums.shared + sums.sum_a);
+}
+
+#endif /* Distance_hpp */
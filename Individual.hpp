@@ -10,203 +10,93 @@
 #define Individual_hpp
 
 #include "Parameters.hpp"
+#include "Distance.hpp"
 
 // The class below defines an individual and the functions corresponding to it
 class Individual {
 public:
     // Individual constructor definition: creates an individual mutated around NestMean and with ID
-    Individual(const int id, const params& p, const std::vector<double>& NestMean, const double NestNeutral);   
+    Individual(const int id, const params& p, SimulationContext& ctx, const cue_profile_t& NestMean, const double NestNeutral);
     
-    std::vector<double> IndiCues;   // Vector containing cue values for individuals
+    cue_profile_t IndiCues;         // Cue values for individuals
     double NeutralGene;             // Neutral gene to report relatedness later
 
     bool bIsGoing = true;           // True if heading out // False if returning
     bool bForage = false;           // True if stealing
     bool bSuccesfulFood = false;    // True if ant carries food on way home
-    double t_birth = uni_real();    // Birth time of each individual, random number between 0 - 1
+    double t_birth;                 // Birth time of each individual, random number between 0 - 1
     double t_next;                  // Next time of action of individual
     int ind_id;                     // Individual identifier
     unsigned int nest_id;           // Nest identifier
 
     // Individual funcions, names are self explanatory
     // more explanation given above function definition
-    void mutate(const params& p);   // Mutates individual cues and neutral gene
+    void mutate(const params& p, SimulationContext& ctx);   // Mutates individual cues and neutral gene
     // Functions below calculate various distances given profiles
-    double calculateGestaltDist(const std::vector<double>& rNestMean, const std::vector<double>& otherProfile) const;
-    double calculateUAbsentDist(const std::vector<double>& rNestMean, const std::vector<double>& otherProfile) const;
-    double calculateDPresentDist(const std::vector<double>& rNestMean, const std::vector<double>& otherProfile) const;
-    double calculateGestaltDistInd(const std::vector<double>& otherProfile) const;
-    double calculateUAbsentDistInd(const std::vector<double>& otherProfile) const;
-    double calculateDPresentDistInd(const std::vector<double>& otherProfile) const;
+    double calculateGestaltDist(const cue_profile_t& rNestMean, const cue_profile_t& otherProfile) const;
+    double calculateUAbsentDist(const cue_profile_t& rNestMean, const cue_profile_t& otherProfile) const;
+    double calculateDPresentDist(const cue_profile_t& rNestMean, const cue_profile_t& otherProfile) const;
+    double calculateGestaltDistInd(const cue_profile_t& otherProfile) const;
+    double calculateUAbsentDistInd(const cue_profile_t& otherProfile) const;
+    double calculateDPresentDistInd(const cue_profile_t& otherProfile) const;
 };
 
 // constructor for new individuals from mutated Nest Mean
 // Also assigns a birth time and time of action to the individual
-Individual::Individual (const int id, const params& p, const std::vector<double>& NestMean, const double NestNeutral) 
-: ind_id(id), NeutralGene(NestNeutral) {
-    for (int i = 0; i < NestMean.size(); i++) {
-        IndiCues.push_back(NestMean[i]);
-    }
-    mutate(p);
-    t_birth = gtime;
-    t_next = t_birth + exponential(p.dMeanActionTime);
+Individual::Individual (const int id, const params& p, SimulationContext& ctx, const cue_profile_t& NestMean, const double NestNeutral) 
+: IndiCues(NestMean), ind_id(id), NeutralGene(NestNeutral), t_birth(uni_real(ctx.rn)) {
+    mutate(p, ctx);
+    t_birth = ctx.gtime;
+    t_next = t_birth + exponential(ctx.rn, p.dMeanActionTime);
 }
 
-// Mutate function
-void Individual::mutate (const params& p) {
+// Mutates cues and neutral gene of worker, an Individual or a WorkerView (Workers.hpp)
+template <typename Worker>
+void mutate_worker(Worker&& worker, const params& p, SimulationContext& ctx) {
     for (int i = 0; i < p.iNumCues; i++) {
         // Multiplied by a fraction less than 1 such that the individuals are closer
         // than colonies are
-        IndiCues[i] += normal(p.dMutBias, p.dMutationStrengthCues*p.dFracIndMutStrength);
-        if (IndiCues[i] < 0) IndiCues[i] = 0.0;
+        worker.IndiCues[i] += normal(ctx.rn, p.dMutBias, p.dMutationStrengthCues*p.dFracIndMutStrength);
+        if (worker.IndiCues[i] < 0) worker.IndiCues[i] = 0.0;
     }
-    NeutralGene += normal(p.dMutBias, p.dMutationStrengthCues*p.dFracIndMutStrength);
+    worker.NeutralGene += normal(ctx.rn, p.dMutBias, p.dMutationStrengthCues*p.dFracIndMutStrength);
 }
 
-// Function to calculate Bray Curtis distance for the "gestalt" recognition mode
-double Individual::calculateGestaltDist(const std::vector<double>& rNestMean, const std::vector<double>& otherProfile) const {
-    double distance = 0.0;
-    double sum1 = 0.0;
-    double sum2 = 0.0;
-
-    for (size_t i = 0; i < rNestMean.size(); ++i) {
-        distance += std::min(rNestMean[i], otherProfile[i]);
-        sum1 += rNestMean[i];
-        sum2 += otherProfile[i];
-    }
-
-    if ((sum1 + sum2) > 0) {
-        distance = 1.0 - (2.0 * distance / (sum1 + sum2));
-    } else {
-        throw std::runtime_error("Sum of profile elements is zero"); // Throw a runtime error
-    }
+// Mutate function
+void Individual::mutate (const params& p, SimulationContext& ctx) {
+    mutate_worker(*this, p, ctx);
+}
 
-    return distance;
+// Distance functions below use the kernels of Distance.hpp, which give the same
+// values as the former per cue loops up to rounding
+// Function to calculate Bray Curtis distance for the "gestalt" recognition mode
+double Individual::calculateGestaltDist(const cue_profile_t& rNestMean, const cue_profile_t& otherProfile) const {
+    return gestalt_distance(rNestMean, otherProfile);
 }
 
 // Function to calculate Bray Curtis distance for the "undesirable-absent" recognition mode
-double Individual::calculateUAbsentDist(const std::vector<double>& rNestMean, const std::vector<double>& otherProfile) const {
-    double distance = 0.0;
-    double sum1 = 0.0;
-    double sum2 = 0.0;
-
-    for (size_t i = 0; i < rNestMean.size(); ++i) {
-        distance += std::min(rNestMean[i], otherProfile[i]);
-        if (otherProfile[i] < rNestMean[i]) {
-            sum1 += otherProfile[i];
-            sum2 += otherProfile[i];
-        } else {
-            sum1 += rNestMean[i];
-            sum2 += otherProfile[i];
-        }
-    }
-
-    if ((sum1 + sum2) > 0) {
-        distance = 1.0 - (2.0 * distance / (sum1 + sum2));
-    } else {
-        throw std::runtime_error("Sum of profile elements is zero"); // Throw a runtime error
-    }
-
-    return distance;
+double Individual::calculateUAbsentDist(const cue_profile_t& rNestMean, const cue_profile_t& otherProfile) const {
+    return uabsent_distance(rNestMean, otherProfile);
 }
 
 // Function to calculate Bray Curtis distance for the "desirable-present" recognition mode
-double Individual::calculateDPresentDist(const std::vector<double>& rNestMean, const std::vector<double>& otherProfile) const {
-    double distance = 0.0;
-    double sum1 = 0.0;
-    double sum2 = 0.0;
-
-    for (size_t i = 0; i < rNestMean.size(); ++i) {
-        distance += std::min(rNestMean[i], otherProfile[i]);
-        if (rNestMean[i] < otherProfile[i]) {
-            sum1 += rNestMean[i];
-            sum2 += rNestMean[i];
-        } else {
-            sum1 += rNestMean[i];
-            sum2 += otherProfile[i];
-        }
-    }
-
-    if ((sum1 + sum2) > 0) {
-        distance = 1.0 - (2.0 * distance / (sum1 + sum2));
-    } else {
-        throw std::runtime_error("Sum of profile elements is zero"); // Throw a runtime error
-    }
-
-    return distance;
+double Individual::calculateDPresentDist(const cue_profile_t& rNestMean, const cue_profile_t& otherProfile) const {
+    return dpresent_distance(rNestMean, otherProfile);
 }
 
 // Function to calculate Bray Curtis distance for the "gestalt" recognition mode
-double Individual::calculateGestaltDistInd(const std::vector<double>& otherProfile) const {
-    double distance = 0.0;
-    double sum1 = 0.0;
-    double sum2 = 0.0;
-
-    for (size_t i = 0; i < IndiCues.size(); ++i) {
-        distance += std::min(IndiCues[i], otherProfile[i]);
-        sum1 += IndiCues[i];
-        sum2 += otherProfile[i];
-    }
-
-    if ((sum1 + sum2) > 0) {
-        distance = 1.0 - (2.0 * distance / (sum1 + sum2));
-    } else {
-        throw std::runtime_error("Sum of profile elements is zero"); // Throw a runtime error
-    }
-
-    return distance;
+double Individual::calculateGestaltDistInd(const cue_profile_t& otherProfile) const {
+    return gestalt_distance(IndiCues, otherProfile);
 }
 
 // Function to calculate Bray Curtis distance for the "undesirable-absent" recognition mode
-double Individual::calculateUAbsentDistInd(const std::vector<double>& otherProfile) const {
-    double distance = 0.0;
-    double sum1 = 0.0;
-    double sum2 = 0.0;
-
-    for (size_t i = 0; i < IndiCues.size(); ++i) {
-        distance += std::min(IndiCues[i], otherProfile[i]);
-        if (otherProfile[i] < IndiCues[i]) {
-            sum1 += otherProfile[i];
-            sum2 += otherProfile[i];
-        } else {
-            sum1 += IndiCues[i];
-            sum2 += otherProfile[i];
-        }
-    }
-
-    if ((sum1 + sum2) > 0) {
-        distance = 1.0 - (2.0 * distance / (sum1 + sum2));
-    } else {
-        throw std::runtime_error("Sum of profile elements is zero"); // Throw a runtime error
-    }
-
-    return distance;
+double Individual::calculateUAbsentDistInd(const cue_profile_t& otherProfile) const {
+    return uabsent_distance(IndiCues, otherProfile);
 }
 
 // Function to calculate Bray Curtis distance for the "desirable-present" recognition mode
-double Individual::calculateDPresentDistInd(const std::vector<double>& otherProfile) const {
-    double distance = 0.0;
-    double sum1 = 0.0;
-    double sum2 = 0.0;
-
-    for (size_t i = 0; i < IndiCues.size(); ++i) {
-        distance += std::min(IndiCues[i], otherProfile[i]);
-        if (IndiCues[i] < otherProfile[i]) {
-            sum1 += IndiCues[i];
-            sum2 += IndiCues[i];
-        } else {
-            sum1 += IndiCues[i];
-            sum2 += otherProfile[i];
-        }
-    }
-
-    if ((sum1 + sum2) > 0) {
-        distance = 1.0 - (2.0 * distance / (sum1 + sum2));
-    } else {
-        throw std::runtime_error("Sum of profile elements is zero"); // Throw a runtime error
-    }
-
-    return distance;
+double Individual::calculateDPresentDistInd(const cue_profile_t& otherProfile) const {
+    return dpresent_distance(IndiCues, otherProfile);
 }
 
 #endif /* Individual_hpp */
@@ -11,31 +11,42 @@
 #ifndef Nest_hpp
 #define Nest_hpp    
 
-#include "Individual.hpp"
+#include "Workers.hpp"
+
+// Stable handle to a nest: slot in the population slot map and generation of that slot
+// Generation is bumped every time the slot is freed, so handles of dead nests go stale
+struct NestHandle {
+    unsigned int slot = 0;
+    unsigned int gen = 0;
+};
 
 class Nest {
 public:
     // Below are the default and reproduced nest functions respectively
-    Nest(const unsigned int nid, const params& p);
-    Nest(const unsigned int nid, const params& p, const Nest& prevNest);
+    Nest(const unsigned int nid, const params& p, SimulationContext& ctx);
+    Nest(const unsigned int nid, const params& p, SimulationContext& ctx, const Nest& prevNest);
+    // Turns a dead nest into a reproduced nest, reusing its storage (see Population::emplace_offspring)
+    void recycle(const unsigned int nid, const params& p, SimulationContext& ctx, const Nest& prevNest);
     
     // Nest variables
     unsigned int nest_id;                       // Nest ID
     unsigned int mom_id;                        // Nest ID for mother nest
     unsigned int lineage_id;                    // Lineage ID
+    NestHandle handle;                          // Slot handle assigned by the population
     unsigned int individual_id_counter = 0;     // Starts every nest ind ID at 0
-    std::vector<Individual> NestWorkers;        // Vector containing workers
-    std::vector<double> NestMean;               // Nest mean cues
-    std::vector<double> NtrlCues;               // Control only under influence of drift 
+    worker_store_t NestWorkers;                 // Workers, layout picked by WORKER_LAYOUT
+    cue_profile_t NestMean;                     // Nest mean cues
+    cue_profile_t NtrlCues;                     // Control only under influence of drift 
+    cue_profile_t WorkerCueSum;                 // Sum of worker cues, fixed as workers keep their cues for life
     double NestNeutralGene;                     // Neutral gene for nest
     double TotalAbundance;                      // Total abundance of nest
     double NtrlTotalAbundance;                  // Total abundance of neutral genes
     double NestStock;                           // Food stock with nest
     double TolIntercept;                        // Intercept for linear/logistic threshold curve
     double TolSlope;                            // Slope for linear/logistic threshold curve
-    double tbirth = gtime;                      // Time of birth
+    double tbirth;                              // Time of birth
     int num_offsprings = 0.0;                   // Number of offsprings
-    double tlast = gtime;                       // Last time of action
+    double tlast;                               // Last time of action
     // Below are various counts for sanity checks
     double nactions = 0.0;                         // Number of actions
     double nsteal = 0.0;
@@ -47,77 +58,191 @@ public:
     double nsucfood = 0.0;
     double nraids = 0.0;
     double nsucraids = 0.0;
+    int num_returning = 0;                      // Workers heading home, new workers all head out
 
     // Nest functions
-    void metabolic_cost(const params& p);       // Subtracts metabolic cost of 1 action
-    void mutate(const params& p);               // Mutates nest cues and neutral gene for new nest
+    void metabolic_cost(const params& p, const SimulationContext& ctx, const int num_actions = 1);    // Subtracts metabolic cost of actions
+    double metabolic_change(const params& p, const double t, const int num_actions) const;     // Stock change metabolic_cost makes at time t
+    void mutate(const params& p, SimulationContext& ctx);   // Mutates nest cues and neutral gene for new nest
+    // Recognition functions below are compiled for one recognition model (Model = iModelChoice)
+    // and one tolerance curve (Tol = iTolChoice), Population::simulate picks the instantiation
+    // Workers and profiles are templates to take an Individual or a WorkerView and its cues
     // Function to check intruder stealing food
-    bool check_Intruder(const params& p, const std::vector<double>& otherProfile) const;
+    template <int Model, int Tol, typename Profile>
+    bool check_Intruder(SimulationContext& ctx, const Profile& otherProfile) const;
     // Function to check resident returning after foraging trip
-    bool check_Resident(const params& p, const Individual& resident) const;
+    template <int Model, int Tol, typename Worker>
+    bool check_Resident(SimulationContext& ctx, const Worker& resident) const;
+    // Function to get probability that intruder is let in, used by tau leaping
+    template <int Model, int Tol, typename Profile>
+    double intruder_prob(SimulationContext& ctx, const Profile& otherProfile) const;
+    // Function to get probability that resident is let back in, used by tau leaping
+    template <int Model, int Tol, typename Worker>
+    double reentry_prob(SimulationContext& ctx, const Worker& resident) const;
+    // Function to get distance of a profile as judged by a resident
+    template <int Model, typename Judge, typename Profile>
+    double calculate_Distance(const Judge& judge, const Profile& otherProfile) const;
     // Function to get tolerance for a particular distance
-    double get_Tolerance(const params&p, const double distance) const;
+    template <int Tol>
+    double get_Tolerance(SimulationContext& ctx, const double distance) const;
     void calculate_abundance(const params& p);  // Calculates abundance
-    size_t findIndexById(const int id);         // Finds index of individual in NestWorkers from ID
+    void calculate_worker_sum(const params& p); // Calculates WorkerCueSum
+    size_t findIndexById(const int id) const;   // Finds index of individual in NestWorkers from ID
+
+private:
+    void inherit(const params& p, SimulationContext& ctx, const Nest& prevNest);   // Offspring part of reproduction
+};
+
+// Fields of a dead nest written to the dead nests file, see Population::printDeadNestsData
+// Records are overwritten in place, so recording a nest allocates nothing and copies no workers
+struct DeadNestRecord {
+    double tbirth;
+    unsigned int nest_id;
+    double NestStock;
+    unsigned int mom_id;
+    double nsteal;
+    double nsucsteal;
+    double nleave;
+    double nsucforage;
+    double nrentry;
+    double nsucrentry;
+    double nraids;
+    double nsucraids;
+    double nactions;
+    double TolIntercept;
+    double TolSlope;
+    int num_offsprings;
+    double NestNeutralGene;
+    cue_profile_t NestMean;
+
+    explicit DeadNestRecord(const Nest& nest) { assign(nest); }
+
+    // Copies every field, never moves: the dead nest keeps its storage for Nest::recycle
+    void assign(const Nest& nest) {
+        tbirth = nest.tbirth;
+        nest_id = nest.nest_id;
+        NestStock = nest.NestStock;
+        mom_id = nest.mom_id;
+        nsteal = nest.nsteal;
+        nsucsteal = nest.nsucsteal;
+        nleave = nest.nleave;
+        nsucforage = nest.nsucforage;
+        nrentry = nest.nrentry;
+        nsucrentry = nest.nsucrentry;
+        nraids = nest.nraids;
+        nsucraids = nest.nsucraids;
+        nactions = nest.nactions;
+        TolIntercept = nest.TolIntercept;
+        TolSlope = nest.TolSlope;
+        num_offsprings = nest.num_offsprings;
+        NestNeutralGene = nest.NestNeutralGene;
+        NestMean = nest.NestMean;
+    }
 };
 
 // Constructor for initial nests
-Nest::Nest(const unsigned int nid, const params& p) : nest_id(nid), lineage_id(nid) {
+Nest::Nest(const unsigned int nid, const params& p, SimulationContext& ctx) :
+ nest_id(nid), lineage_id(nid), NestMean(p.iNumCues), NtrlCues(p.iNumCues), tbirth(ctx.gtime), tlast(ctx.gtime) {
 
     // Initialise nest mean from exponential distribution
     for (int i = 0; i < p.iNumCues; i++) {
-        double CueVal = exponential(p.dExpParam);
-        NestMean.push_back(CueVal);
-        NtrlCues.push_back(CueVal);
+        double CueVal = exponential(ctx.rn, p.dExpParam);
+        NestMean[i] = CueVal;
+        NtrlCues[i] = CueVal;
     }
     mom_id = 0;                                     // Initial nests
     calculate_abundance(p);                         // Calculate abundance
     NestStock = p.dInitNestStock;                   // Create initial nest stock
     // Assign values to neutral, intercept and slope genes
-    NestNeutralGene = 0.0 + normal(p.dMutBias, p.dMutationStrengthCues);
-    TolIntercept = normal(dInitIntercept, p.dMutationStrength);
-    TolSlope = normal(dInitSlope, p.dMutationStrength);
+    NestNeutralGene = 0.0 + normal(ctx.rn, p.dMutBias, p.dMutationStrengthCues);
+    TolIntercept = normal(ctx.rn, dInitIntercept, p.dMutationStrength);
+    TolSlope = normal(ctx.rn, dInitSlope, p.dMutationStrength);
 
     // Create and push individuals into NestWorkers vector
     // Also increments individual ID counter
     for (int i = 0; i < p.iNumWorkers; i++) {
-        Individual newWorker(individual_id_counter, p, NestMean, NestNeutralGene);
+        Individual newWorker(individual_id_counter, p, ctx, NestMean, NestNeutralGene);
         newWorker.nest_id = nid;
         ++individual_id_counter;
         NestWorkers.push_back(newWorker);
     }
+    calculate_worker_sum(p);
 } 
 
 // Constructor for reproduced nests
-Nest::Nest(const unsigned int nid, const params& p, const Nest& prevNest) :
- nest_id(nid), NestMean(prevNest.NestMean), NestNeutralGene(prevNest.NestNeutralGene), NtrlCues(prevNest.NtrlCues) {
+Nest::Nest(const unsigned int nid, const params& p, SimulationContext& ctx, const Nest& prevNest) :
+ nest_id(nid), NestMean(prevNest.NestMean), NestNeutralGene(prevNest.NestNeutralGene), NtrlCues(prevNest.NtrlCues),
+ tbirth(ctx.gtime), tlast(ctx.gtime) {
+    inherit(p, ctx, prevNest);
+}
 
-    mutate(p);                          // Mutate nest cues and neutral gene
+// Reproduction into the storage of a dead nest, gives the same nest as the constructor above
+// Profiles and workers are overwritten in place, so no memory is allocated
+void Nest::recycle(const unsigned int nid, const params& p, SimulationContext& ctx, const Nest& prevNest) {
+    nest_id = nid;
+    handle = NestHandle{};
+    NestMean = prevNest.NestMean;
+    NtrlCues = prevNest.NtrlCues;
+    NestNeutralGene = prevNest.NestNeutralGene;
+    tbirth = ctx.gtime;
+    tlast = ctx.gtime;
+    individual_id_counter = 0;
+    num_offsprings = 0;
+    nactions = 0.0;
+    nsteal = 0.0;
+    nsucsteal = 0.0;
+    nleave = 0.0;
+    nsucforage = 0.0;
+    nrentry = 0.0;
+    nsucrentry = 0.0;
+    nsucfood = 0.0;
+    nraids = 0.0;
+    nsucraids = 0.0;
+    num_returning = 0;
+    inherit(p, ctx, prevNest);
+}
+
+// Mutation, tolerance genes and workers of a reproduced nest
+// Workers already in NestWorkers (recycled nests) are renewed in place
+void Nest::inherit(const params& p, SimulationContext& ctx, const Nest& prevNest) {
+    mutate(p, ctx);                          // Mutate nest cues and neutral gene
     calculate_abundance(p);             // Calculate abundance
     NestStock = p.dInitNestStock;       // Assign initial nest stock
     mom_id = prevNest.nest_id;          // Assign mom nest ID
     lineage_id = prevNest.lineage_id;   // Assign lineage ID
-    if (bIsCoevolve) {                  // If coevolve is true mutate intercept and slope too
-        TolIntercept = prevNest.TolIntercept + normal(p.dMutBias, p.dMutationStrength);
-        TolSlope = prevNest.TolSlope + normal(p.dMutBias, p.dMutationStrength);
+    if (ctx.bIsCoevolve) {                  // If coevolve is true mutate intercept and slope too
+        TolIntercept = prevNest.TolIntercept + normal(ctx.rn, p.dMutBias, p.dMutationStrength);
+        TolSlope = prevNest.TolSlope + normal(ctx.rn, p.dMutBias, p.dMutationStrength);
     } else {                            // If coevolve is not true, choose specific values for intercept and slope
-        TolIntercept = normal(dInitIntercept, p.dMutationStrength);
-        TolSlope = normal(dInitSlope, p.dMutationStrength);
+        TolIntercept = normal(ctx.rn, dInitIntercept, p.dMutationStrength);
+        TolSlope = normal(ctx.rn, dInitSlope, p.dMutationStrength);
     }
 
     // Create and add workers to NestWorkers vector
     for (int i = 0; i < p.iNumWorkers; i++) {
-        Individual newWorker(individual_id_counter, p, NestMean, NestNeutralGene);
-        newWorker.nest_id = nid;
+        if (static_cast<size_t>(i) < NestWorkers.size()) {
+            auto&& worker = NestWorkers[i];
+            renew_worker(worker, individual_id_counter, p, ctx, NestMean, NestNeutralGene);
+            worker.nest_id = nest_id;
+        } else {
+            Individual newWorker(individual_id_counter, p, ctx, NestMean, NestNeutralGene);
+            newWorker.nest_id = nest_id;
+            NestWorkers.push_back(newWorker);
+        }
         ++individual_id_counter;
-        NestWorkers.push_back(newWorker);
     }
+    calculate_worker_sum(p);
 }
 
 // Subtract metabolic cost
-void Nest::metabolic_cost(const params& p){
-    NestStock += (gtime - tlast)*p.dRateNestStock - p.dMetabolicCost*TotalAbundance/2000.0/static_cast<double>(p.iNumWorkers);
-    tlast = gtime;
+void Nest::metabolic_cost(const params& p, const SimulationContext& ctx, const int num_actions){
+    NestStock += metabolic_change(p, ctx.gtime, num_actions);
+    tlast = ctx.gtime;
+}
+
+// Regeneration since the last action up to time t, minus the metabolic cost of num_actions actions
+double Nest::metabolic_change(const params& p, const double t, const int num_actions) const {
+    return (t - tlast)*p.dRateNestStock - num_actions*p.dMetabolicCost*TotalAbundance/2000.0/static_cast<double>(p.iNumWorkers);
 }
 
 // Calculate total abundance from NestMean
@@ -130,128 +255,147 @@ void Nest::calculate_abundance(const params& p) {
     }
 }
 
+// Sum of the cues of all workers, kept by the population for its mean profile
+// Recycled nests already hold a sum of the right size, so it is overwritten in place
+void Nest::calculate_worker_sum(const params& p) {
+    if (WorkerCueSum.size() != static_cast<size_t>(p.iNumCues)) WorkerCueSum = cue_profile_t(p.iNumCues);
+    std::fill(WorkerCueSum.begin(), WorkerCueSum.end(), 0.0);
+    for (const auto& worker : NestWorkers) {
+        for (int i = 0; i < p.iNumCues; i++) {
+            WorkerCueSum[i] += worker.IndiCues[i];
+        }
+    }
+}
+
 // Function to search by indidivual ID in a nest and return index
-size_t Nest::findIndexById(const int id) {
-    auto it = std::find_if(NestWorkers.begin(), NestWorkers.end(), [id](const Individual& ind) {
-        return ind.ind_id == id;
-    });
-    if (it != NestWorkers.end()) {
-        return std::distance(NestWorkers.begin(), it);
-    } else {
-        // Return some sentinel value  to indicate not found
-        return -1;
+// Workers are never removed from a nest, so the ID is also the index (O(1))
+// Linear search is kept as fallback in case the two ever diverge
+size_t Nest::findIndexById(const int id) const {
+    if (id >= 0 && static_cast<size_t>(id) < NestWorkers.size() && NestWorkers[id].ind_id == id) {
+        return static_cast<size_t>(id);
+    }
+    for (size_t i = 0; i < NestWorkers.size(); ++i) {
+        if (NestWorkers[i].ind_id == id) return i;
     }
+    // Return some sentinel value  to indicate not found
+    return -1;
 }
 
 // Mutates nest cues and neutral gene
 // Also makes sure the cues dont reach negative values
-void Nest::mutate(const params& p) {
+void Nest::mutate(const params& p, SimulationContext& ctx) {
     for (int i = 0; i < p.iNumCues; i++) {
-        NestMean[i] += normal(p.dMutBias, p.dMutationStrengthCues);
-        NtrlCues[i] += normal(p.dMutBias, p.dMutationStrengthCues);
+        NestMean[i] += normal(ctx.rn, p.dMutBias, p.dMutationStrengthCues);
+        NtrlCues[i] += normal(ctx.rn, p.dMutBias, p.dMutationStrengthCues);
         if (NestMean[i] < 0.0) NestMean[i] = 0.0;
         if (NtrlCues[i] < 0.0) NtrlCues[i] = 0.0;
     }
-    NestNeutralGene += normal(p.dMutBias, p.dMutationStrengthCues);
+    NestNeutralGene += normal(ctx.rn, p.dMutBias, p.dMutationStrengthCues);
 }
 
 // Target nest function to check if intruder can enter or not
-bool Nest::check_Intruder(const params& p, const std::vector<double>& otherProfile) const {
-    double distance = 0.0;
+template <int Model, int Tol, typename Profile>
+bool Nest::check_Intruder(SimulationContext& ctx, const Profile& otherProfile) const {
     // Choose a resident ant at random to interact with the intruder LC????
-    size_t resIndex = uni_int(0, NestWorkers.size());
+    size_t resIndex = uni_int(ctx.rn, 0, NestWorkers.size());
     
-    switch (static_cast<int>(p.iModelChoice))
-    {   // Calculate distance of intruder from resident based on choice of model
-    case 0:
-        distance = NestWorkers[resIndex].calculateGestaltDist(NestMean, otherProfile);
-        break;
-    case 1:
-        distance = NestWorkers[resIndex].calculateDPresentDist(NestMean, otherProfile);
-        break;
-    case 2:
-        distance = NestWorkers[resIndex].calculateUAbsentDist(NestMean, otherProfile);
-        break;
-    case 3:
-        return bernoulli(0.5);
-        break;
-    case 4:
-        distance = NestWorkers[resIndex].calculateGestaltDistInd(otherProfile);
-        break;
-    case 5:
-        distance = NestWorkers[resIndex].calculateDPresentDistInd(otherProfile);
-        break;
-    case 6:
-        distance = NestWorkers[resIndex].calculateUAbsentDistInd(otherProfile);
-        break;
-    default:
-        break;
+    // Random choice of model
+    if constexpr (Model == 3) {
+        return bernoulli(ctx.rn, 0.5);
+    } else {
+        // Calculate distance of intruder from resident based on choice of model
+        double distance = calculate_Distance<Model>(NestWorkers[resIndex], otherProfile);
+
+        // Get tolerance based on distance metric decided
+        double tolerance = get_Tolerance<Tol>(ctx, distance);
+        // 
+        return !bernoulli(ctx.rn, tolerance);
     }
+}
 
-    // Get tolerance based on distance metric decided
-    double tolerance = get_Tolerance(p, distance);
-    // 
-    return !bernoulli(tolerance);
+// Probability of the check in check_Intruder letting an intruder with otherProfile in
+// Draws the judging resident the same way, leaves the final coin flips to the caller
+template <int Model, int Tol, typename Profile>
+double Nest::intruder_prob(SimulationContext& ctx, const Profile& otherProfile) const {
+    size_t resIndex = uni_int(ctx.rn, 0, NestWorkers.size());
+    if constexpr (Model == 3) {
+        return 0.5;
+    } else {
+        double distance = calculate_Distance<Model>(NestWorkers[resIndex], otherProfile);
+        return 1.0 - get_Tolerance<Tol>(ctx, distance);
+    }
 }
 
 // Resident nest function to check if resident can return successfully
-bool Nest::check_Resident(const params& p, const Individual& resident) const {
-    double distance = 0.0;
+template <int Model, int Tol, typename Worker>
+bool Nest::check_Resident(SimulationContext& ctx, const Worker& resident) const {
     // Choose random resident that is NOT the same as returning individual
-    int resIndex = uni_int(0, NestWorkers.size());
+    int resIndex = uni_int(ctx.rn, 0, NestWorkers.size());
     if (NestWorkers[resIndex].ind_id == resident.ind_id) {
         while (NestWorkers[resIndex].ind_id == resident.ind_id) {
-            resIndex = uni_int(0, NestWorkers.size());
+            resIndex = uni_int(ctx.rn, 0, NestWorkers.size());
         }   
     }
 
-    switch (static_cast<int>(p.iModelChoice))
-    {   // Calculate distance of returning resident from resident based on choice of model
-    case 0:
-        distance = NestWorkers[resIndex].calculateGestaltDist(NestMean, resident.IndiCues);
-        break;
-    case 1:
-        distance = NestWorkers[resIndex].calculateDPresentDist(NestMean, resident.IndiCues);
-        break;
-    case 2:
-        distance = NestWorkers[resIndex].calculateUAbsentDist(NestMean, resident.IndiCues);
-        break;
-    case 3:
-        return bernoulli(0.5);
-        break;
-    case 4:
-        distance = NestWorkers[resIndex].calculateGestaltDistInd(resident.IndiCues);
-        break;
-    case 5:
-        distance = NestWorkers[resIndex].calculateDPresentDistInd(resident.IndiCues);
-        break;
-    case 6:
-        distance = NestWorkers[resIndex].calculateUAbsentDistInd(resident.IndiCues);
-        break;
-    default:
-        break;
+    // Random choice of model
+    if constexpr (Model == 3) {
+        return bernoulli(ctx.rn, 0.5);
+    } else {
+        // Calculate distance of returning resident from resident based on choice of model
+        double distance = calculate_Distance<Model>(NestWorkers[resIndex], resident.IndiCues);
+        // Get tolerance from distance and choice of model
+        double tolerance = get_Tolerance<Tol>(ctx, distance);
+        return !bernoulli(ctx.rn, tolerance);
+    }
+}
+
+// Probability of the check in check_Resident letting resident back in
+// Draws the judging resident the same way, leaves the final coin flip to the caller
+template <int Model, int Tol, typename Worker>
+double Nest::reentry_prob(SimulationContext& ctx, const Worker& resident) const {
+    int resIndex = uni_int(ctx.rn, 0, NestWorkers.size());
+    while (NestWorkers[resIndex].ind_id == resident.ind_id) {
+        resIndex = uni_int(ctx.rn, 0, NestWorkers.size());
+    }
+    if constexpr (Model == 3) {
+        return 0.5;
+    } else {
+        double distance = calculate_Distance<Model>(NestWorkers[resIndex], resident.IndiCues);
+        return 1.0 - get_Tolerance<Tol>(ctx, distance);
+    }
+}
+
+// Distance of otherProfile as judged by resident judge based on choice of model
+// Models 0-2 compare against the nest mean, models 4-6 against the judge's own cues
+template <int Model, typename Judge, typename Profile>
+double Nest::calculate_Distance(const Judge& judge, const Profile& otherProfile) const {
+    static_assert(Model >= 0 && Model <= 6 && Model != 3, "No distance for this iModelChoice");
+    if constexpr (Model == 0) {
+        return gestalt_distance(NestMean, otherProfile);
+    } else if constexpr (Model == 1) {
+        return dpresent_distance(NestMean, otherProfile);
+    } else if constexpr (Model == 2) {
+        return uabsent_distance(NestMean, otherProfile);
+    } else if constexpr (Model == 4) {
+        return gestalt_distance(judge.IndiCues, otherProfile);
+    } else if constexpr (Model == 5) {
+        return dpresent_distance(judge.IndiCues, otherProfile);
+    } else {
+        return uabsent_distance(judge.IndiCues, otherProfile);
     }
-    // Get tolerance from distance and choice of model
-    double tolerance = get_Tolerance(p, distance);
-    return !bernoulli(tolerance);
 }
 
-double Nest::get_Tolerance(const params&p, const double distance) const {
+template <int Tol>
+double Nest::get_Tolerance(SimulationContext& ctx, const double distance) const {
+    static_assert(Tol >= 0 && Tol <= 2, "No tolerance curve for this iTolChoice");
     double tolerance = 0.0;
 
-    switch (static_cast<int>(p.iTolChoice))
-    {
-    case 0:         // Linear Tolerance scenario
+    if constexpr (Tol == 0) {           // Linear Tolerance scenario
         tolerance = TolIntercept + TolSlope*distance;
-        break;
-    case 1:         // Logistic Tolerance scenario
+    } else if constexpr (Tol == 1) {    // Logistic Tolerance scenario
         tolerance = logistic(distance, TolIntercept, TolSlope);
-        break;
-    case 2:         // Control random Tolerance scenario
-        tolerance = uni_real();
-        break;
-    default:
-        break;
+    } else {                            // Control random Tolerance scenario
+        tolerance = uni_real(ctx.rn);
     }
 
     // Ensure tolerance belongs to [0.0, 1.0]
@@ -0,0 +1,244 @@
+//
+//  PairwiseStats.hpp
+//  Croziers Paradox
+//
+//  Copyright © 2024 Lakshya Chauhan. All rights reserved.
+//  -> Defines mean and standard deviation of all pairwise Bray Curtis distances of a set of profiles
+//  -> Exact mode walks the pairs in tiles on one or more threads without storing the distances
+//  -> Sampled mode estimates both from random pairs until the mean is within a given error
+//  -> PairwiseSums keeps them up to date for profiles that are fixed while in the set, as nest profiles
+//  Pt 2.6
+
+#ifndef PairwiseStats_hpp
+#define PairwiseStats_hpp
+
+#include "Distance.hpp"
+#include "Random.hpp"
+#include <vector>
+#include <tuple>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+
+// Number of profiles per side of a tile, a tile of 10 cue profiles fits in L1
+const size_t iPairTile = 64;
+// Pairs drawn per round of the sampled estimator, and the least number of rounds
+const size_t iPairSampleBatch = 1024;
+const size_t iPairSampleMinBatches = 4;
+
+// Count, mean and sum of squared deviations of a set of values (Welford)
+// Values come singly or in batches, each batch is summarised in two passes and merged (Chan et al.)
+// Values merged before can be taken out again by the inverse merge, so the set may shrink
+struct RunningStats {
+    double count = 0.0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    void add(const double x) { merge(RunningStats{1.0, x, 0.0}); }
+    void remove(const double x) { unmerge(RunningStats{1.0, x, 0.0}); }
+    void add_batch(const double* values, const size_t n) { merge(summary(values, n)); }
+    void remove_batch(const double* values, const size_t n) { unmerge(summary(values, n)); }
+
+    void merge(const RunningStats& other) {
+        if (other.count == 0.0) return;
+        const double total = count + other.count;
+        const double delta = other.mean - mean;
+        mean += delta * other.count / total;
+        m2 += other.m2 + delta * delta * count * other.count / total;
+        count = total;
+    }
+
+    // Inverse of merge, every value of other must be in the set
+    void unmerge(const RunningStats& other) {
+        if (other.count == 0.0) return;
+        const double rest = count - other.count;
+        if (rest <= 0.0) {
+            *this = RunningStats{};                 // Drops the rounding left by the removals
+            return;
+        }
+        const double rest_mean = (count * mean - other.count * other.mean) / rest;
+        const double delta = other.mean - rest_mean;
+        m2 = std::max(0.0, m2 - other.m2 - delta * delta * rest * other.count / count);
+        mean = rest_mean;
+        count = rest;
+    }
+
+    // Population standard deviation, as mean_std
+    double std_dev() const { return std::sqrt(m2 / count); }
+
+    // Mean and population standard deviation, (0, nan) for an empty set as mean_std of no values
+    std::tuple<double, double> mean_std() const {
+        if (count == 0.0) return std::make_tuple(0.0, std::nan(""));
+        return std::make_tuple(mean, std_dev());
+    }
+
+private:
+    static RunningStats summary(const double* values, const size_t n) {
+        if (n == 0) return RunningStats{};
+        double batch_mean = 0.0;
+        for (size_t i = 0; i < n; ++i) batch_mean += values[i];
+        batch_mean /= static_cast<double>(n);
+        double batch_m2 = 0.0;
+        for (size_t i = 0; i < n; ++i) batch_m2 += (values[i] - batch_mean) * (values[i] - batch_mean);
+        return RunningStats{static_cast<double>(n), batch_mean, batch_m2};
+    }
+};
+
+// Bray Curtis distance of rows i and j from their shared amount, row totals are precomputed
+// Two empty profiles (all cues 0, e.g. after mutations clamp every cue) are identical, distance 0
+inline double pair_distance(const double* profiles, const std::vector<double>& totals, const size_t num_cues,
+                            const size_t i, const size_t j) {
+    static const ProfileSumsKernel kernel = select_profile_sums();
+    const double total = totals[i] + totals[j];
+    if (total <= 0.0) return 0.0;
+    const double shared = kernel(profiles + i * num_cues, profiles + j * num_cues, num_cues).shared;
+    return 1.0 - 2.0 * shared / total;
+}
+
+// Sums of every row of a row major [n x num_cues] matrix
+inline std::vector<double> row_totals(const std::vector<double>& profiles, const size_t num_cues) {
+    const size_t n = num_cues == 0 ? 0 : profiles.size() / num_cues;
+    std::vector<double> totals(n, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t c = 0; c < num_cues; ++c) totals[i] += profiles[i * num_cues + c];
+    }
+    return totals;
+}
+
+// Mean and standard deviation of the distances of all pairs of rows of profiles, a row major
+// [n x num_cues] matrix. Pairs are visited in tiles of iPairTile x iPairTile rows, and the
+// distances of a tile are folded into the statistics of its block row before the next tile,
+// so memory stays O(n) instead of O(n^2). Block rows are dealt round robin to num_threads
+// threads and merged in block order, so results do not depend on the number of threads
+std::tuple<double, double> pairwise_bray_curtis_exact(const std::vector<double>& profiles, const size_t num_cues,
+                                                      const size_t num_threads = 1) {
+    const std::vector<double> totals = row_totals(profiles, num_cues);
+    const size_t n = totals.size();
+    if (n < 2) return std::make_tuple(0.0, std::nan(""));      // No pairs, as mean_std of no values
+
+    const size_t num_blocks = (n + iPairTile - 1) / iPairTile;
+    std::vector<RunningStats> block_stats(num_blocks);
+
+    auto run_blocks = [&](const size_t first, const size_t step) {
+        std::vector<double> tile(iPairTile * iPairTile);
+        for (size_t bi = first; bi < num_blocks; bi += step) {
+            const size_t i_end = std::min(n, (bi + 1) * iPairTile);
+            for (size_t bj = bi; bj < num_blocks; ++bj) {
+                const size_t j_end = std::min(n, (bj + 1) * iPairTile);
+                size_t num_pairs = 0;
+                for (size_t i = bi * iPairTile; i < i_end; ++i) {
+                    for (size_t j = std::max(i + 1, bj * iPairTile); j < j_end; ++j) {
+                        tile[num_pairs++] = pair_distance(profiles.data(), totals, num_cues, i, j);
+                    }
+                }
+                block_stats[bi].add_batch(tile.data(), num_pairs);
+            }
+        }
+    };
+
+    const size_t threads = std::max<size_t>(1, std::min(num_threads, num_blocks));
+    if (threads == 1) {
+        run_blocks(0, 1);
+    } else {
+        std::vector<std::thread> pool;
+        for (size_t t = 0; t < threads; ++t) pool.emplace_back(run_blocks, t, threads);
+        for (auto& thread : pool) thread.join();
+    }
+
+    RunningStats stats;
+    for (const auto& block : block_stats) stats.merge(block);
+    return std::make_tuple(stats.mean, stats.std_dev());
+}
+
+// Estimate of pairwise_bray_curtis_exact from uniformly drawn pairs of distinct rows
+// Draws batches of pairs until the 95% confidence half width of the mean, 1.96 s / sqrt(m),
+// is at most max_error. Falls back to the exact statistics once that needs as many draws as
+// there are pairs. Draws from rn, which should be a stream of its own (iStreamStatistics)
+// so that sampling leaves the simulation unchanged
+std::tuple<double, double> pairwise_bray_curtis_sampled(const std::vector<double>& profiles, const size_t num_cues,
+                                                        const double max_error, rng_t& rn, const size_t num_threads = 1) {
+    const std::vector<double> totals = row_totals(profiles, num_cues);
+    const size_t n = totals.size();
+    const double num_pairs = 0.5 * static_cast<double>(n) * static_cast<double>(n - 1);
+    if (n < 2 || num_pairs <= static_cast<double>(iPairSampleBatch * iPairSampleMinBatches)) {
+        return pairwise_bray_curtis_exact(profiles, num_cues, num_threads);
+    }
+
+    RunningStats stats;
+    std::vector<double> batch(iPairSampleBatch);
+    for (size_t round = 0; ; ++round) {
+        for (auto& distance : batch) {
+            size_t i = uni_int(rn, static_cast<size_t>(0), n);
+            size_t j = uni_int_excluding(rn, n, i);
+            distance = pair_distance(profiles.data(), totals, num_cues, i, j);
+        }
+        stats.add_batch(batch.data(), batch.size());
+        if (round + 1 < iPairSampleMinBatches) continue;
+        const double half_width = 1.96 * std::sqrt(stats.m2 / (stats.count - 1.0)) / std::sqrt(stats.count);
+        if (half_width <= max_error) break;
+        if (stats.count >= num_pairs) return pairwise_bray_curtis_exact(profiles, num_cues, num_threads);
+    }
+    return std::make_tuple(stats.mean, stats.std_dev());
+}
+
+// Pairwise Bray Curtis statistics of a changing set of profiles, each fixed while it is in the set
+// as nest profiles (NestMean, NtrlCues) are fixed at birth. A copy of each profile is kept by a
+// stable slot (NestSlots), so adding a profile costs O(n K) and the mean and standard deviation
+// O(1), in O(n K) memory. Removal costs O(n K) too, not O(n): it recomputes the distances of the
+// profile from the same copies and totals, so it subtracts exactly what its addition added,
+// where storing the distances would take O(n^2) memory
+class PairwiseSums {
+public:
+    PairwiseSums() = default;
+    explicit PairwiseSums(const size_t cues) : num_cues(cues) {}
+
+    // Adds profile in slot, which must not be in the set
+    template <typename Profile>
+    void add(const size_t slot, const Profile& profile) {
+        if (slot >= totals.size()) grow(slot + 1);
+        double total = 0.0;
+        for (size_t c = 0; c < num_cues; ++c) {
+            cues[slot * num_cues + c] = profile[c];
+            total += profile[c];
+        }
+        totals[slot] = total;
+        distances.clear();
+        for (const size_t other : live) distances.push_back(pair_distance(cues.data(), totals, num_cues, slot, other));
+        stats.add_batch(distances.data(), distances.size());
+        live_pos[slot] = live.size();
+        live.push_back(slot);
+    }
+
+    // Removes profile in slot, which must be in the set
+    void remove(const size_t slot) {
+        live[live_pos[slot]] = live.back();
+        live_pos[live.back()] = live_pos[slot];
+        live.pop_back();
+        distances.clear();
+        for (const size_t other : live) distances.push_back(pair_distance(cues.data(), totals, num_cues, slot, other));
+        stats.remove_batch(distances.data(), distances.size());
+    }
+
+    size_t size() const { return live.size(); }
+
+    // Same as pairwise_bray_curtis_exact of the profiles in the set, up to rounding
+    std::tuple<double, double> mean_std() const { return stats.mean_std(); }
+
+private:
+    // Room for num_slots slots, slots only grow by one at a time as NestSlots hands them out
+    void grow(const size_t num_slots) {
+        cues.resize(num_slots * num_cues, 0.0);
+        totals.resize(num_slots, 0.0);
+        live_pos.resize(num_slots, 0);
+    }
+
+    size_t num_cues = 0;
+    std::vector<double> cues;               // Row per slot, [slots x num_cues]
+    std::vector<double> totals;             // Cue total per slot
+    std::vector<size_t> live;               // Slots in the set
+    std::vector<size_t> live_pos;           // Position of each slot in live
+    RunningStats stats;                     // Distances of all pairs in the set
+    std::vector<double> distances;          // Work buffer, distances of the profile added or removed
+};
+
+#endif /* PairwiseStats_hpp */
@@ -17,17 +17,35 @@
 
 namespace fs = std::filesystem;
 
-// Variables needed at compile time OR variables not explored in variation
-double gtime = 0.0;                               // Global time
-double dRemovalTime = 200.0;                      // Removal time -> unit time after which lowest stock colonies die
-double max_gtime_evolution = dRemovalTime*1000.0;    // Time for evolution phase of simulations
-double dReproductionTime = dRemovalTime;          // Reproduction time -> numTicks after mass reproduction occurs
-double dOutputTime = 100.1;                        // Interval after which population stats are outputed
-double dFracDeadNest = 0.0;                       // Fraction of dead nests recorded in output files
-double dFracResetSteal = 0.99;                    // Time after which steal is set to 0 to obtain proper values
+// Constants needed at compile time
 const double dInitIntercept = 0.0;                // Initial value of intercept for linear / logistic comparison
 const double dInitSlope = 1.0;                    // Initial value of slope for linear / logistic function
-bool bIsCoevolve = false;                         // Wether tolerance co-evolves with the cues
+const bool bDebugStorer = false;                  // Cross-checks storer vectors against nests after every event
+const size_t iDeadNestBuffer = 1024;              // Dead nest records held in memory before they are written out early
+
+// The struct below holds the clock, random number generator and the variables
+// not explored in variation of ONE simulation. Every Population owns its own
+// context, so independent simulations can run side by side in one process
+struct SimulationContext {
+  SimulationContext() : SimulationContext(make_master_seed()) {};
+  explicit SimulationContext(const uint64_t seed, const uint32_t rep = 0) :
+    master_seed(seed), replicate(rep), simulationID(make_simulationID(seed, rep)),
+    rn(seed, rep, iStreamSimulation), stat_rn(seed, rep, iStreamStatistics) {};
+
+  uint64_t master_seed;                             // Master seed of the ensemble
+  uint32_t replicate;                               // Replicate number within the ensemble
+  unsigned int simulationID;                        // Names output files, fixed by master seed and replicate
+  rng_t rn;                                         // Random number stream of this replicate
+  rng_t stat_rn;                                    // Random number stream of sampled output statistics
+  double gtime = 0.0;                               // Simulation time
+  double dRemovalTime = 200.0;                      // Removal time -> unit time after which lowest stock colonies die
+  double max_gtime_evolution = dRemovalTime*1000.0;    // Time for evolution phase of simulations
+  double dReproductionTime = dRemovalTime;          // Reproduction time -> numTicks after mass reproduction occurs
+  double dOutputTime = 100.1;                       // Interval after which population stats are outputed
+  double dFracDeadNest = 0.0;                       // Fraction of dead nests recorded in output files
+  double dFracResetSteal = 0.99;                    // Time after which steal is set to 0 to obtain proper values
+  bool bIsCoevolve = false;                         // Wether tolerance co-evolves with the cues
+};
 
 // The struct below contains parameters that WILL BE read
 // from a config file
@@ -64,6 +82,16 @@ struct params {
   double iFoodResetChoice = 0;      // Reset nest and population stock at mass reproduction point
                                     // 1 for yes reset, 0 for no reset
   double iConstStockChoice = 0;     // 0 linearly increasing | 1 for const pop stock | 2 for tick system 
+  double iSchedulerChoice = 1;      // 0 for single binary heap, 1 for two level per-nest scheduler, 2 for calendar queue
+  double iEngineChoice = 0;         // 0 for per-worker next reaction loop, 1 for Gillespie direct method, 2 for tau leaping (approximate, experimental)
+  double dTauLeap = 1.0;            // Max length of a leap IF iEngineChoice = 2 (experimental, not yet faster than 1)
+  double dLeapStockFrac = 0.5;      // Max expected fraction of a food stock used up within one tau leap
+  double iBCNestChoice = 2;         // Pairwise Bray Curtis of nest profiles: 0 exact, 1 sampled, 2 running sums
+                                    // 2 costs O(nests x cues) per birth and per death, and keeps a copy of every nest profile
+  double iBCAntChoice = 0;          // Pairwise Bray Curtis of worker profiles: 0 exact, 1 sampled
+  double iBCNtrlChoice = 2;         // Pairwise Bray Curtis of neutral nest profiles: 0 exact, 1 sampled, 2 running sums, costs as iBCNestChoice
+  double dBCMaxError = 0.001;       // Max 95% confidence half width of sampled pairwise Bray Curtis means
+  double iStatThreads = 1;          // Threads for exact pairwise Bray Curtis, on top of replicate threads
 
   std::string temp_params_to_record;                  // Temp variable
   std::vector < std::string > param_names_to_record;  // Parameter names to add to output files
@@ -95,6 +123,16 @@ struct params {
     iRepChoice               = from_config.getValueOfKey<double>("iRepChoice");
     iFoodResetChoice         = from_config.getValueOfKey<double>("iFoodResetChoice");
     iConstStockChoice        = from_config.getValueOfKey<double>("iConstStockChoice");
+    // Keys below are optional, older config files keep the default values
+    iSchedulerChoice         = from_config.getValueOfKey<double>("iSchedulerChoice", iSchedulerChoice);
+    iEngineChoice            = from_config.getValueOfKey<double>("iEngineChoice", iEngineChoice);
+    dTauLeap                 = from_config.getValueOfKey<double>("dTauLeap", dTauLeap);
+    dLeapStockFrac           = from_config.getValueOfKey<double>("dLeapStockFrac", dLeapStockFrac);
+    iBCNestChoice            = from_config.getValueOfKey<double>("iBCNestChoice", iBCNestChoice);
+    iBCAntChoice             = from_config.getValueOfKey<double>("iBCAntChoice", iBCAntChoice);
+    iBCNtrlChoice            = from_config.getValueOfKey<double>("iBCNtrlChoice", iBCNtrlChoice);
+    dBCMaxError              = from_config.getValueOfKey<double>("dBCMaxError", dBCMaxError);
+    iStatThreads             = from_config.getValueOfKey<double>("iStatThreads", iStatThreads);
     temp_params_to_record    = from_config.getValueOfKey<std::string>("params_to_record");
     param_names_to_record    = split(temp_params_to_record);
     params_to_record         = create_params_to_record(param_names_to_record);
@@ -147,6 +185,15 @@ struct params {
     if (s == "iRepChoice")                return iRepChoice;
     if (s == "iFoodResetChoice")          return iFoodResetChoice;
     if (s == "iConstStockChoice")          return iConstStockChoice;
+    if (s == "iSchedulerChoice")          return iSchedulerChoice;
+    if (s == "iEngineChoice")             return iEngineChoice;
+    if (s == "dTauLeap")                  return dTauLeap;
+    if (s == "dLeapStockFrac")            return dLeapStockFrac;
+    if (s == "iBCNestChoice")             return iBCNestChoice;
+    if (s == "iBCAntChoice")              return iBCAntChoice;
+    if (s == "iBCNtrlChoice")             return iBCNtrlChoice;
+    if (s == "dBCMaxError")               return dBCMaxError;
+    if (s == "iStatThreads")              return iStatThreads;
     // ADD PARAMS TO RECORD
     throw std::runtime_error("can not find parameter");
     return -1.f; // FAIL
@@ -160,6 +207,9 @@ struct params {
     std::vector<std::string> repchoice = {"mass", "individual", "both", "control"};
     std::vector<std::string> foodresetchoice = {"no", "yes"};
     std::vector<std::string> constPopStockchoice = {"linearly increasing", "constant population stock", "tick based reset"};
+    std::vector<std::string> schedulerchoice = {"binary heap", "per-nest two level", "calendar queue"};
+    std::vector<std::string> enginechoice = {"next reaction", "direct method", "tau leaping"};
+    std::vector<std::string> bcchoice = {"exact", "sampled", "running sums"};
 
     std::cout << "Model : " << modelchoice[iModelChoice] << std::endl;
     std::cout << "Tolerance : " << tolchoice[iTolChoice] << std::endl;
@@ -167,22 +217,25 @@ struct params {
     std::cout << "Reproduction : " << repchoice[iRepChoice] << std::endl;      
     std::cout << "Food Reset : " << foodresetchoice[iFoodResetChoice] << std::endl;
     std::cout << "Const Pop Stock : " << constPopStockchoice[iConstStockChoice] << std::endl;
+    std::cout << "Scheduler : " << schedulerchoice[iSchedulerChoice] << std::endl;
+    std::cout << "Engine : " << enginechoice[iEngineChoice] << std::endl;
+    std::cout << "Pairwise BC nest/ant/ntrl : " << bcchoice[iBCNestChoice] << "/" << bcchoice[iBCAntChoice] << "/" << bcchoice[iBCNtrlChoice] << std::endl;
   }
 };
 
 // Function to export parameters to a CSV file
-void exportParametersToCSV(const params& p) {
+void exportParametersToCSV(const params& p, const SimulationContext& ctx) {
     // Open the file in write mode
-    fs::path parameterPath = fs::path("./output_sim/" + std::to_string(simulationID) + "_parameter.csv");
+    fs::path parameterPath = fs::path("./output_sim/" + std::to_string(ctx.simulationID) + "_parameter.csv");
     std::ofstream file(parameterPath);
 
     // Write the header
     file << "max_gtime_evolution,dRemovalTime,dReproductionTime,dTickTime,dOutputTime,dFracDeadNest,dFracResetSteal,dInitIntercept,dInitSlope,bIsCoevolve,";
-    file << "dFracKilled,dMetabolicCost,dMutationStrength,dMutationStrengthCues,dFracIndMutStrength,dMutBias,iNumWorkers,iNumCues,iNumColonies,dInitNestStock,dInitFoodStock,dExpParam,dMeanActionTime,dRatePopStock,dConstantPopStock,dRateNestStock,iModelChoice,iTolChoice,iKillChoice,iRepChoice,iFoodResetChoice,iConstStockChoice\n";
+    file << "dFracKilled,dMetabolicCost,dMutationStrength,dMutationStrengthCues,dFracIndMutStrength,dMutBias,iNumWorkers,iNumCues,iNumColonies,dInitNestStock,dInitFoodStock,dExpParam,dMeanActionTime,dRatePopStock,dConstantPopStock,dRateNestStock,iModelChoice,iTolChoice,iKillChoice,iRepChoice,iFoodResetChoice,iConstStockChoice,iSchedulerChoice,iEngineChoice,dTauLeap,masterSeed,replicate,iBCNestChoice,iBCAntChoice,iBCNtrlChoice,dBCMaxError,iStatThreads,dLeapStockFrac\n";
 
     // Write the values
-    file << max_gtime_evolution << "," << dRemovalTime << "," << dReproductionTime << "," << p.dTickTime << "," << dOutputTime << "," << dFracDeadNest << "," << dFracResetSteal << "," << dInitIntercept << "," << dInitSlope << "," << bIsCoevolve << ",";
-    file << p.dFracKilled << "," << p.dMetabolicCost << "," << p.dMutationStrength << "," << p.dMutationStrengthCues << "," << p.dFracIndMutStrength << "," << p.dMutBias << "," << p.iNumWorkers << "," << p.iNumCues << "," << p.iNumColonies << "," << p.dInitNestStock << "," << p.dInitFoodStock << "," << p.dExpParam << "," << p.dMeanActionTime << "," << p.dRatePopStock << "," << p.dConstantPopStock << "," << p.dRateNestStock << "," << p.iModelChoice << "," << p.iTolChoice << "," << p.iKillChoice << "," << p.iRepChoice << "," << p.iFoodResetChoice << "," << p.iConstStockChoice << "\n";
+    file << ctx.max_gtime_evolution << "," << ctx.dRemovalTime << "," << ctx.dReproductionTime << "," << p.dTickTime << "," << ctx.dOutputTime << "," << ctx.dFracDeadNest << "," << ctx.dFracResetSteal << "," << dInitIntercept << "," << dInitSlope << "," << ctx.bIsCoevolve << ",";
+    file << p.dFracKilled << "," << p.dMetabolicCost << "," << p.dMutationStrength << "," << p.dMutationStrengthCues << "," << p.dFracIndMutStrength << "," << p.dMutBias << "," << p.iNumWorkers << "," << p.iNumCues << "," << p.iNumColonies << "," << p.dInitNestStock << "," << p.dInitFoodStock << "," << p.dExpParam << "," << p.dMeanActionTime << "," << p.dRatePopStock << "," << p.dConstantPopStock << "," << p.dRateNestStock << "," << p.iModelChoice << "," << p.iTolChoice << "," << p.iKillChoice << "," << p.iRepChoice << "," << p.iFoodResetChoice << "," << p.iConstStockChoice << "," << p.iSchedulerChoice << "," << p.iEngineChoice << "," << p.dTauLeap << "," << ctx.master_seed << "," << ctx.replicate << "," << p.iBCNestChoice << "," << p.iBCAntChoice << "," << p.iBCNtrlChoice << "," << p.dBCMaxError << "," << p.iStatThreads << "," << p.dLeapStockFrac << "\n";
 
     // Close the file
     file.close();
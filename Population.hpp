@@ -11,57 +11,177 @@
 #ifndef Population_hpp
 #define Population_hpp    
 
-#include "Nest.hpp"
-#include <queue>
+#include "Scheduler.hpp"
+#include "PairwiseStats.hpp"
 #include <iomanip> // For std::setprecision
 #include <sstream> // For std::ostringstream
-#include <set>
 
 namespace fs = std::filesystem;
 
-// track_time struct for event queue ordered by next task time
-struct track_time {
-    double time;
-    unsigned int nest_id;
-    int ind_id;
-
-    // event constructor using initializer lists
-    track_time(const Individual& input) :
-        time{input.t_next},
-        nest_id{input.nest_id},
-        ind_id{input.ind_id}
-    {}
+// Slot map from stable nest slots to the current index in the nests vector
+// Nests move when remove_from_vec swaps the last nest into a freed index,
+// the slot map follows them so handles stay valid for the whole life of a nest
+class NestSlots {
+public:
+    // Occupies a free slot for nest at given index and returns its handle
+    NestHandle acquire(const size_t nestIndex) {
+        unsigned int slot;
+        if (!free_slots.empty()) {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            slot = static_cast<unsigned int>(slot_index.size());
+            slot_index.push_back(0);
+            slot_gen.push_back(0);
+        }
+        slot_index[slot] = nestIndex;
+        return NestHandle{slot, slot_gen[slot]};
+    }
+
+    // Frees slot and bumps its generation, invalidating all handles to it
+    void release(const NestHandle& handle) {
+        ++slot_gen[handle.slot];
+        free_slots.push_back(handle.slot);
+    }
+
+    // Nest in slot was moved to a new index in the nests vector
+    void relocate(const NestHandle& handle, const size_t nestIndex) {
+        slot_index[handle.slot] = nestIndex;
+    }
+
+    // Returns index of nest in nests vector, -1 if the nest is dead
+    int resolve(const NestHandle& handle) const {
+        if (handle.slot < slot_gen.size() && slot_gen[handle.slot] == handle.gen) {
+            return static_cast<int>(slot_index[handle.slot]);
+        }
+        return -1;
+    }
+
+private:
+    std::vector<size_t> slot_index;                 // Index in nests vector per slot
+    std::vector<unsigned int> slot_gen;             // Current generation per slot
+    std::vector<unsigned int> free_slots;           // Slots of dead nests ready for reuse
+};
+
+// Compile time copy of the choice parameters that branch inside the simulation loop
+// Population::simulate dispatches once into the loop instantiated for the run's choices,
+// so recognition, tolerance, kill and reproduction branches are resolved by the compiler
+template <int Model, int Tol, int Kill, int Rep>
+struct SimPolicy {
+    static constexpr int model = Model;                         // iModelChoice
+    static constexpr int tol = Tol;                             // iTolChoice
+    static constexpr int kill = Kill;                           // iKillChoice
+    static constexpr int rep = Rep;                             // iRepChoice
+    static constexpr bool bIndividualRep = (Rep == 1 || Rep == 2);  // Nest reproduces when one dies
+    static constexpr bool bMassRep = (Rep == 0 || Rep == 2);        // Nests reproduce after mass kill
 };
 
-// Lambda function for maintaining priority queue
-auto cmptime = [](const track_time& a, const track_time& b) { return a.time > b.time; };
+// Functions below call run.template operator()<SimPolicy<...>>() for the choices in p
+// Each level resolves one choice, wrong choices throw like the other choice parameters
+template <int Model, int Tol, int Kill, typename Run>
+void dispatch_rep(const params& p, Run& run) {
+    switch (static_cast<int>(p.iRepChoice))
+    {
+    case 0: run.template operator()<SimPolicy<Model, Tol, Kill, 0>>(); break;
+    case 1: run.template operator()<SimPolicy<Model, Tol, Kill, 1>>(); break;
+    case 2: run.template operator()<SimPolicy<Model, Tol, Kill, 2>>(); break;
+    default: throw std::runtime_error("Wrong choice of iRepChoice");
+    }
+}
+
+template <int Model, int Tol, typename Run>
+void dispatch_kill(const params& p, Run& run) {
+    switch (static_cast<int>(p.iKillChoice))
+    {
+    case 0: dispatch_rep<Model, Tol, 0>(p, run); break;
+    case 1: dispatch_rep<Model, Tol, 1>(p, run); break;
+    case 2: dispatch_rep<Model, Tol, 2>(p, run); break;
+    default: throw std::runtime_error("Wrong choice of iKillChoice");
+    }
+}
+
+// Random recognition (model 3) never uses the tolerance curve, so it gets a single instantiation
+template <int Model, typename Run>
+void dispatch_tol(const params& p, Run& run) {
+    if constexpr (Model == 3) {
+        dispatch_kill<Model, 0>(p, run);
+    } else {
+        switch (static_cast<int>(p.iTolChoice))
+        {
+        case 0: dispatch_kill<Model, 0>(p, run); break;
+        case 1: dispatch_kill<Model, 1>(p, run); break;
+        case 2: dispatch_kill<Model, 2>(p, run); break;
+        default: throw std::runtime_error("Wrong choice of iTolChoice");
+        }
+    }
+}
+
+template <typename Run>
+void dispatch_policy(const params& p, Run&& run) {
+    switch (static_cast<int>(p.iModelChoice))
+    {
+    case 0: dispatch_tol<0>(p, run); break;
+    case 1: dispatch_tol<1>(p, run); break;
+    case 2: dispatch_tol<2>(p, run); break;
+    case 3: dispatch_tol<3>(p, run); break;
+    case 4: dispatch_tol<4>(p, run); break;
+    case 5: dispatch_tol<5>(p, run); break;
+    case 6: dispatch_tol<6>(p, run); break;
+    default: throw std::runtime_error("Wrong choice of iModelChoice");
+    }
+}
 
 class Population {
 public:
-    // Constructor for population from parameter struct
-    Population(const params& par) : p(par), event_queue(cmptime) { };
+    // Constructor for population from parameter struct and its own simulation context
+    Population(const params& par, const SimulationContext& context = SimulationContext()) :
+        p(par), ctx(context), event_queue(make_scheduler(par)),
+        bTrackMotherWeights(par.iRepChoice == 1 || par.iRepChoice == 2) { };
 
     std::vector<Nest> nests;                        // Vector containing nests
-    std::vector<Nest> deadnests;                    // holds dead nests till they can be printed
     unsigned int nest_id_counter = 1;               // nest ID counter 
     params p;                                       // Parameters defining current population
+    SimulationContext ctx;                          // Clock, random numbers and run settings of this simulation
     double PopStock = p.dInitFoodStock;             // population food stock
     // vector to store nest IDs and food stocks corresponding to nest indexes
     // becomes important as nests die
+    // Kept in sync in place on every stock change, birth and death
     std::vector<unsigned int> storer_nest_id;
     std::vector<double> storer_stocks;
+    NestSlots slots;                                // Slot map giving O(1) nest lookup from handles
+    // Stock weights for choosing mothers, Fenwick tree kept in sync with storer_stocks
+    // if nests reproduce individually, alias table built once per mass reproduction
+    FenwickSampler mother_weights;
+    AliasTable mass_mothers;
 
     void initialise_pop();                                      // Initialise population
     void simulate(const std::vector<std::string>& param_names); // Simulate population
-    void update_storer();                                       // Updates the storer vectors
-    void kill_nest(const unsigned int nestId);                  // Kills specific nest 
+    // Simulation loop and everything it calls per event are compiled per SimPolicy
+    template <typename Policy>
+    void run_next_reaction(std::ostream& evolution_file, std::ostream& dn_file); // Per-worker event loop
+    template <typename Policy>
+    void run_direct_method(std::ostream& evolution_file, std::ostream& dn_file); // Population level Gillespie loop
+    template <typename Policy>
+    void run_tau_leap(std::ostream& evolution_file, std::ostream& dn_file);      // Approximate tau leaping loop
+    template <typename Policy>
+    size_t perform_action(size_t cnestindex, const size_t cindindex); // One action of a worker, returns nest index
+    void update_storer(const size_t nestIndex);                 // Updates storer stock of nest at index
+    void check_storer() const;                                  // Cross-checks storer vectors with nests
+    template <typename Policy>
+    void kill_nest(const size_t nestIndex);                     // Kills nest at index
     void reproduce_nest();                                      // Single reproduction event
-    int findIndexByNestId(unsigned int nestId);                 // returns index of Nest ID in nests vector
+    void schedule_system_events();                              // puts first housekeeping events in system_queue
+    template <typename Policy>
+    void fire_system_event(std::ostream& evolution_file, std::ostream& dn_file); // fires earliest housekeeping event
+    template <typename Policy>
     void mass_kill();                                           // kills nests in mass
+    template <typename Policy>
     void mass_reproduce();                                      // mass reproduces colonies
     void regenerate_food();                                     // linearly increase food stock
-    int target_nest(Individual& indi);                          // find nest to steal from, or forage
-    void check_nests(const unsigned int nestId);                // Check if nestID is alive, kill if not 
+    template <typename Worker>
+    int target_nest(Worker&& indi, const size_t nestIndex);     // find nest index to steal from, or forage
+    template <typename Policy>
+    void check_nests(const size_t nestIndex);                   // Check if nest at index is alive, kill if not 
     // Output functions
     void reset_counters();
     void printPopulationState(const std::vector< float >& param_values, std::ostream& csv_file);
@@ -69,19 +189,83 @@ public:
     void printDeadNestsData(const std::vector< float >& param_values, std::ostream& csv_file);
 
 private:
-    double last_MassKill_time = 0.0;                // Time since last purge of colonies
-    double last_MassRep_time = 0.0;                 // Time since last mass reproduction event
-    double last_TickUpdate_time = 0.0;              // Time since last pop stock was updated IF tick based food
+    template <typename Policy>
     void random_kill();                             // in mass kill, doesnt sort
-    void sorted_kill();                             // in mass kill, sorts and kills
-    void remove_nest(const unsigned int nestID);    // remove nests used in mass kill
+    template <typename Policy>
+    void sorted_kill();                             // in mass kill, selects lowest stocks and kills
+    void remove_marked_nests();                     // removes nests marked in kill_marks in one pass
+    double leap_length(const double going) const;   // length of next tau leap given number of workers heading out
+    template <typename Policy>
+    void direct_step(const double t_next);          // one action of a uniformly chosen worker at t_next
+    template <typename Policy>
+    bool plan_leap(const double tau, const double going);  // draws a leap, false if a nest would go below zero stock
+    template <typename Policy>
+    void plan_nest(const size_t nestIndex, const double tau, const double pforage); // draws actions of a nest in a leap
+    void apply_leap(const double tau);              // applies the leap drawn by plan_leap
+    void register_nest();                           // assign slot handle to last nest in nests
+    void emplace_offspring(const size_t MotherIndex);   // add offspring of nest at index to back of nests
+    void erase_nest(const size_t nestIndex);        // remove nest at index and fix slot map
+    void record_dead_nest(const size_t nestIndex);  // records dying nest at index with chance dFracDeadNest
+    void spill_dead_nests();                        // writes the dead nests buffer once it is full
     std::vector<double> calculateMeanProfile() const;   // Calculates mean profile of population
+    // Pairwise Bray Curtis statistics as per choice, from running sums or of the profiles gather puts in stat_profiles
+    template <typename Gather>
+    std::tuple<double, double> pairwise_stat(const double choice, const char* choice_name, const PairwiseSums* running, Gather&& gather);
+    std::vector<double> stat_profiles;              // Work buffer of output statistics, profiles as rows
+    void update_pop_sums(const Nest& nest, const double sign);  // adds (+1) or removes (-1) nest from pop sums
+    void add_offspring(const size_t MotherIndex);   // counts one more offspring of nest at index
+    // Running sums over all live workers behind calculateMeanProfile, updated on every birth and death of a nest
+    std::vector<double> pop_cue_sums;               // Sum of cues of all workers
+    double pop_num_workers = 0.0;                   // Number of workers
+    double pop_num_returning = 0.0;                 // Number of workers heading home, the rest head out
+    // Running pairwise Bray Curtis of NestMean and NtrlCues of all nests, if chosen (2)
+    PairwiseSums nest_pair_sums;
+    PairwiseSums ntrl_pair_sums;
+    // Running moments of nest values behind the output statistics
+    RunningStats pop_intercepts;
+    RunningStats pop_slopes;
+    RunningStats pop_cueabun;
+    RunningStats pop_ntrlcueabun;
+    RunningStats pop_offsprings;
+    std::vector<unsigned int> lineage_counts;       // Live nests per lineage ID
+    int num_lineages = 0;                           // Lineage IDs with live nests
+    // Work buffers of relatedness, neutral genes of two random workers per nest
+    std::vector<double> related_genes1;
+    std::vector<double> related_genes2;
     double tlastregen = 0.0;                        // Last food regeneration time
-    double last_evolution_time = 0.0;               // Last time of population output
-    double last_deadnest_time = 0.0;                // Last time of deadnest output
-    // Event queue below for maintaining gillespe
-    std::priority_queue<track_time, std::vector<track_time>, decltype(cmptime)> event_queue; 
-    std::vector<Nest> deadNests;                    // Vector to store all the dead nests collected
+    // Event queue below for maintaining gillespe, implementation picked by iSchedulerChoice
+    std::unique_ptr<EventScheduler> event_queue;
+    // Housekeeping events ordered by time, fired in between worker events
+    std::priority_queue<system_time, std::vector<system_time>, decltype(cmpsystem)> system_queue{cmpsystem};
+    bool bTrackMotherWeights;                       // True if individual reproduction needs mother_weights
+    // Work buffers of mass kill, kept between rounds to avoid allocations
+    std::vector<char> kill_marks;                   // 1 if nest at index dies this round
+    std::vector<size_t> kill_order;                 // Index permutation for random kill
+    std::vector<double> kill_stocks;                // Stock copy for threshold selection
+    // Tau leap drawn by plan_leap, counts per nest and end state of every worker that acted
+    struct NestLeap {
+        int actions = 0, leaves = 0, forages = 0, steals = 0, sucsteals = 0;
+        int returns = 0, foodreturns = 0, reentries = 0, raids = 0, sucraids = 0;
+    };
+    struct WorkerLeap {
+        size_t nest;
+        size_t worker;
+        bool bGoing;
+        bool bFood;
+    };
+    std::vector<NestLeap> leap_plan;
+    std::vector<WorkerLeap> leap_workers;
+    std::vector<size_t> leap_draws;                 // Work buffers of tau leaping, draws of multinomial splits
+    std::vector<size_t> leap_targets;
+    // Dead nests kept for their storage, reproduction recycles them so that steady state
+    // kill and reproduction rounds do not allocate. Holds at most iNumColonies nests
+    std::vector<Nest> spare_nests;
+    // Records of dead nests collected since the last output, only the first num_dead are in use
+    // A buffer of iDeadNestBuffer records is written to dead_nest_file once the kill that filled it is done,
+    // a mass kill may overfill it until then
+    std::vector<DeadNestRecord> deadNests;
+    size_t num_dead = 0;
+    std::ostream* dead_nest_file = nullptr;         // Dead nests file of the running simulation
     // count variables for sanity checks below
     double cnt_sucrentry = 0;
     double cnt_sucfood = 0;
@@ -90,7 +274,6 @@ private:
     double cnt_sucforage = 0;
     double cnt_rentry = 0;
     double cnt_leave = 0;
-    bool reset_cnt = false;
     // Tuples and variables to store population outputs
     std::tuple<double, double, double> gen_stuff;
     std::tuple<double, double> stat_bc_nest;
@@ -114,62 +297,104 @@ private:
 };
 
 // Function to calculate the mean profile of the population
+// Served from the running sums, so it costs O(iNumCues) instead of a walk over all workers
 std::vector<double> Population::calculateMeanProfile() const {
     if (nests.empty()) {
         // If there are no nests, return an empty vector or handle it accordingly
         return std::vector<double>();
     }
 
-    std::vector<double> meanProfile(p.iNumCues, 0.0);
-
-    // Variables to accumulate profiles and count workers
-    size_t totalWorkers = 0;
-
-    for (const auto& nest : nests) {
-        for (const auto& worker : nest.NestWorkers) {
-            for (size_t i = 0; i < p.iNumCues; ++i) {
-                meanProfile[i] += worker.IndiCues[i];
-            }
-            ++totalWorkers;
-        }
-    }
+    std::vector<double> meanProfile(pop_cue_sums);
 
     // Calculate the mean for each profile element
     for (size_t i = 0; i < p.iNumCues; ++i) {
-        meanProfile[i] /= static_cast<double>(totalWorkers);
+        meanProfile[i] /= pop_num_workers;
     }
 
     return meanProfile;
 }
 
+// Function to get mean and std of pairwise Bray Curtis distances, read from running (choice 2)
+// or computed over the rows gather puts in stat_profiles
+// Sampled statistics draw from the statistics stream, so the choice never changes the dynamics
+template <typename Gather>
+std::tuple<double, double> Population::pairwise_stat(const double choice, const char* choice_name, const PairwiseSums* running, Gather&& gather) {
+    if (choice == 2 && running != nullptr) return running->mean_std();
+    stat_profiles.clear();
+    gather();
+    const size_t threads = static_cast<size_t>(p.iStatThreads);
+    if (choice == 0) return pairwise_bray_curtis_exact(stat_profiles, p.iNumCues, threads);
+    if (choice == 1) return pairwise_bray_curtis_sampled(stat_profiles, p.iNumCues, p.dBCMaxError, ctx.stat_rn, threads);
+    throw std::runtime_error(std::string("Wrong choice of ") + choice_name);
+}
+
+// Function to add a nest to the population sums (sign 1) or remove it (sign -1)
+// Its slot handle must be set, it keys the nest in the pairwise sums
+void Population::update_pop_sums(const Nest& nest, const double sign) {
+    for (size_t i = 0; i < p.iNumCues; ++i) {
+        pop_cue_sums[i] += sign * nest.WorkerCueSum[i];
+    }
+    pop_num_workers += sign * static_cast<double>(nest.NestWorkers.size());
+    pop_num_returning += sign * static_cast<double>(nest.num_returning);
+    if (sign > 0) {
+        pop_intercepts.add(nest.TolIntercept);
+        pop_slopes.add(nest.TolSlope);
+        pop_cueabun.add(nest.TotalAbundance);
+        pop_ntrlcueabun.add(nest.NtrlTotalAbundance);
+        pop_offsprings.add(nest.num_offsprings);
+        if (nest.lineage_id >= lineage_counts.size()) lineage_counts.resize(nest.lineage_id + 1, 0);
+        if (lineage_counts[nest.lineage_id]++ == 0) ++num_lineages;
+    } else {
+        pop_intercepts.remove(nest.TolIntercept);
+        pop_slopes.remove(nest.TolSlope);
+        pop_cueabun.remove(nest.TotalAbundance);
+        pop_ntrlcueabun.remove(nest.NtrlTotalAbundance);
+        pop_offsprings.remove(nest.num_offsprings);
+        if (--lineage_counts[nest.lineage_id] == 0) --num_lineages;
+    }
+    if (p.iBCNestChoice == 2) {
+        if (sign > 0) nest_pair_sums.add(nest.handle.slot, nest.NestMean);
+        else nest_pair_sums.remove(nest.handle.slot);
+    }
+    if (p.iBCNtrlChoice == 2) {
+        if (sign > 0) ntrl_pair_sums.add(nest.handle.slot, nest.NtrlCues);
+        else ntrl_pair_sums.remove(nest.handle.slot);
+    }
+}
+
+// Function to count one more offspring of nest at index, keeping pop_offsprings in sync
+void Population::add_offspring(const size_t MotherIndex) {
+    pop_offsprings.remove(nests[MotherIndex].num_offsprings);
+    nests[MotherIndex].num_offsprings++;
+    pop_offsprings.add(nests[MotherIndex].num_offsprings);
+}
+
 // initialise population function
 void Population::initialise_pop() {
+    // Nests never exceed iNumColonies, so nests is never reallocated after this
+    nests.reserve(static_cast<size_t>(p.iNumColonies));
+    spare_nests.reserve(static_cast<size_t>(p.iNumColonies));
+    pop_cue_sums.assign(p.iNumCues, 0.0);
+    nest_pair_sums = PairwiseSums(p.iNumCues);
+    ntrl_pair_sums = PairwiseSums(p.iNumCues);
+    lineage_counts.assign(static_cast<size_t>(p.iNumColonies) + 1, 0);   // Lineage IDs are the initial nest IDs
     // Create nests and push them to nests and storer_nest_id vector
     for(int i=0; i < p.iNumColonies; ++i) {
-        nests.emplace_back(nest_id_counter, p);
+        nests.emplace_back(nest_id_counter, p, ctx);
+        register_nest();
         ++nest_id_counter;
     }
-    update_storer();
 }
 
 void Population::simulate(const std::vector<std::string>& param_names){
-    // Created a priority queue to track individuals by their next action time
-    // Priority queue initialised in the private section of Population
-    // Initialize the event queue with individuals and their initial next action times
-    for (auto& nest : nests) {
-        for (auto& individual : nest.NestWorkers) {
-            event_queue.push(track_time(individual));
-        }
-    }
-
     // Create output files for entire simulation, dead nests and final state file
-    fs::path evolutionPath = fs::path("./output_sim/" + std::to_string(simulationID) + "_evolution.csv");
+    fs::path evolutionPath = fs::path("./output_sim/" + std::to_string(ctx.simulationID) + "_evolution.csv");
     std::ofstream evolution_file(evolutionPath);
 
-    fs::path deadnestPath = fs::path("./output_sim/" + std::to_string(simulationID) + "_deadNests.csv");
+    fs::path deadnestPath = fs::path("./output_sim/" + std::to_string(ctx.simulationID) + "_deadNests.csv");
     std::ofstream dn_file(deadnestPath);
     
-    fs::path finalState = fs::path("./output_sim/" + std::to_string(simulationID) + "_finState.csv");
+    fs::path finalState = fs::path("./output_sim/" + std::to_string(ctx.simulationID) + "_finState.csv");
     std::ofstream fs_file(finalState);
 
     // Add headers and parameter names to be recorded to first row
@@ -194,127 +419,446 @@ void Population::simulate(const std::vector<std::string>& param_names){
 
     dn_file << std::endl;
     dn_file.flush();
+    dead_nest_file = &dn_file;
+
+    // Start simulation loop with engine picked by iEngineChoice,
+    // compiled for the model, tolerance, kill and reproduction choices of this run
+    schedule_system_events();
+    dispatch_policy(p, [&]<typename Policy>() {
+        switch (static_cast<int>(p.iEngineChoice))
+        {
+        case 0:
+            run_next_reaction<Policy>(evolution_file, dn_file);
+            break;
+        case 1:
+            run_direct_method<Policy>(evolution_file, dn_file);
+            break;
+        case 2:
+            run_tau_leap<Policy>(evolution_file, dn_file);
+            break;
+        default:
+            throw std::runtime_error("Wrong choice of iEngineChoice");
+        }
+    });
 
-    // Start simulation loop
-    while (gtime < max_gtime_evolution) {
+    // Output last point of output
+    printLastPopulationState(p.params_to_record,fs_file);
+    fs_file.close();
+    evolution_file.close();
+    dn_file.close();
+    dead_nest_file = nullptr;
+}
+
+// Next reaction loop: every worker carries its own next action time t_next
+// and the event scheduler hands out the earliest one
+template <typename Policy>
+void Population::run_next_reaction(std::ostream& evolution_file, std::ostream& dn_file) {
+    // Initialize the event queue with individuals and their initial next action times
+    for (auto& nest : nests) {
+        event_queue->push_nest(nest);
+    }
+
+    while (ctx.gtime < ctx.max_gtime_evolution) {
 
-        if (event_queue.empty()) {
+        if (event_queue->empty()) {
             // No more events to process
             // Can happen in case of hostile situations when populaton dies out
             std::cout << "ERROR: event_queue empty" << std::endl;
             break;
         }
 
-        //Call massk_kill, mass_reproducem reset counters and output functions every single time
-        mass_kill();
-        mass_reproduce();
-        reset_counters();
-        printPopulationState(p.params_to_record, evolution_file);
-        printDeadNestsData(p.params_to_record, dn_file);
+        // Fire mass kill, mass reproduction, food ticks, counter reset and outputs
+        // at their scheduled times when they are due before the next worker action
+        if (!system_queue.empty() && system_queue.top().time <= event_queue->next_time()) {
+            if (system_queue.top().time >= ctx.max_gtime_evolution) break;
+            fire_system_event<Policy>(evolution_file, dn_file);
+            continue;
+        }
 
         // Take the next action indiviual and pop it from the queue
-        track_time next_event = event_queue.top();
-        event_queue.pop();
+        track_time next_event = event_queue->pop();
 
-        // Find nest index, ID and individual ID from next event
-        size_t cnestindex = findIndexByNestId(next_event.nest_id);
+        // Resolve nest index through the slot handle, -1 if nest died since
+        // Events of dead nests are skipped without moving the clock
+        int cnestindex = slots.resolve(next_event.nest);
+        if (cnestindex == -1) continue;
         auto cindid = next_event.ind_id;
-        auto cnestid = next_event.nest_id;
-        gtime = next_event.time;                // Increment global time
+        ctx.gtime = next_event.time;                // Increment global time
         regenerate_food();                      // Regenerate pop stock as per model choice
 
-        // If current individual is from colonies ALIVE
-        if (cnestindex != -1) {
-            auto cindindex = nests[cnestindex].findIndexById(cindid);
-            // current points to memory location of current individual
-            Individual& current{nests[cnestindex].NestWorkers[cindindex]};
-            nests[cnestindex].metabolic_cost(p);                // Subtract metabolic burden and regenerate
-            update_storer();
-            current.t_next += exponential(p.dMeanActionTime);   // Update next action time
-            nests[cnestindex].nactions++;
-
-            // Check whether in colony or out
-            if (current.bIsGoing) {
-                // If outside colony, check whether foraging or steal
-                int if_target = target_nest(current);
-                // If foraging
-                nests[cnestindex].nleave++;
-                cnt_leave++;     
-                if (current.bForage) {
-                    PopStock -= 1.0;            // Reduce population stock size
-                    current.bSuccesfulFood = true;
-                    cnt_sucforage++;
-                    nests[cnestindex].nsucforage++;
-                } else {
-                    // If stealing
-                    int target_nest_index = findIndexByNestId(if_target);
-                    // Check if intrusion is successful
-                    bool success = nests[target_nest_index].check_Intruder(p, current.IndiCues);
-                    cnt_steal++;   
-                    nests[cnestindex].nsteal++;
-                    nests[target_nest_index].nraids++;
-
-                    // if successful in stealing
-                    if (success) {
-                        nests[target_nest_index].NestStock -= 1.0;
-                        update_storer();
-                        current.bSuccesfulFood = true;
-                        nests[target_nest_index].nsucraids++;
-                        check_nests(if_target);
-                        cnt_sucsteal++; 
-                        nests[cnestindex].nsucsteal++;
-                    }
-                    current.bSuccesfulFood = false;
-                }
-                // Action done, change to incoming
-                current.bIsGoing = false;
-            } else {
-                // If returning to colony, check whether successful or not
-                if (current.bSuccesfulFood) {
-                    // Returning with food, resident check
-                    bool greatEntry = nests[cnestindex].check_Resident(p, current);
-                    cnt_sucfood++;
-                    nests[cnestindex].nsucfood++;
-                    if (greatEntry) {
-                        nests[cnestindex].NestStock += 1.0;
-                        update_storer();
-                        cnt_sucrentry++;           
-                        nests[cnestindex].nsucrentry++;
-                    }
+        // Update next action time, then act and put the worker back in the queue
+        auto cindindex = nests[cnestindex].findIndexById(cindid);
+        nests[cnestindex].NestWorkers[cindindex].t_next += exponential(ctx.rn, p.dMeanActionTime);
+        cnestindex = perform_action<Policy>(cnestindex, cindindex);
+        event_queue->push(track_time(nests[cnestindex].NestWorkers[cindindex], next_event.nest));
+        check_nests<Policy>(cnestindex);
+
+        if (bDebugStorer) check_storer();
+        // Last action time of population assigned to tlastregen
+        tlastregen = ctx.gtime;
+    }
+}
+
+// Gillespie direct method: all workers act at the same rate, so the population
+// acts at total rate (number of workers x rate) and the actor is a uniformly chosen worker
+// Exact reformulation of the next reaction loop without t_next or any event queue
+template <typename Policy>
+void Population::run_direct_method(std::ostream& evolution_file, std::ostream& dn_file) {
+    while (ctx.gtime < ctx.max_gtime_evolution) {
+
+        if (nests.empty()) {
+            // Can happen in case of hostile situations when populaton dies out
+            std::cout << "ERROR: no nests left" << std::endl;
+            break;
+        }
+
+        // All nests hold iNumWorkers workers, exponential takes the rate as in the
+        // next reaction loop, so the population rate is workers x dMeanActionTime
+        const double num_workers = static_cast<double>(nests.size()) * p.iNumWorkers;
+        const double t_next = ctx.gtime + exponential(ctx.rn, num_workers * p.dMeanActionTime);
+
+        // Housekeeping due first fires at its own time, the action time is then
+        // drawn again, which is exact since waiting times are memoryless
+        if (!system_queue.empty() && system_queue.top().time <= t_next) {
+            if (system_queue.top().time >= ctx.max_gtime_evolution) break;
+            fire_system_event<Policy>(evolution_file, dn_file);
+            continue;
+        }
+
+        direct_step<Policy>(t_next);
+
+        if (bDebugStorer) check_storer();
+        // Last action time of population assigned to tlastregen
+        tlastregen = ctx.gtime;
+    }
+}
+
+// Function to perform one step of the direct method at time t_next
+template <typename Policy>
+void Population::direct_step(const double t_next) {
+    ctx.gtime = t_next;                         // Increment global time
+    regenerate_food();                      // Regenerate pop stock as per model choice
+
+    // Uniform worker: uniform nest, then uniform worker within it since nests are equally sized
+    size_t cnestindex = uni_int(ctx.rn, static_cast<size_t>(0), nests.size());
+    int cindid = uni_int(ctx.rn, 0, static_cast<int>(nests[cnestindex].NestWorkers.size()));
+    cnestindex = perform_action<Policy>(cnestindex, nests[cnestindex].findIndexById(cindid));
+    check_nests<Policy>(cnestindex);
+}
+
+// Tau leaping loop: time moves in leaps, within a leap every worker draws its number of actions
+// and each nest applies the summed stock changes once. Approximate, the order of actions within
+// a leap is lost, meant for long parameter scans where only the long run statistics matter
+// Leaps end at housekeeping events, so mass kill and reproduction never fall inside a leap
+// A leap is drawn first and only applied if no nest ends it below zero stock, otherwise it is
+// drawn again at half the length (Cao, Gillespie and Petzold 2005). Where that leaves workers
+// less than one action per leap, exact direct method steps are taken instead
+template <typename Policy>
+void Population::run_tau_leap(std::ostream& evolution_file, std::ostream& dn_file) {
+    while (ctx.gtime < ctx.max_gtime_evolution) {
+
+        if (nests.empty()) {
+            // Can happen in case of hostile situations when populaton dies out
+            std::cout << "ERROR: no nests left" << std::endl;
+            break;
+        }
+
+        // Housekeeping due at the end of the last leap fires first
+        if (!system_queue.empty() && system_queue.top().time <= ctx.gtime) {
+            if (system_queue.top().time >= ctx.max_gtime_evolution) break;
+            fire_system_event<Policy>(evolution_file, dn_file);
+            continue;
+        }
+
+        const double going = pop_num_workers - pop_num_returning;
+        double tau = leap_length(going);
+        bool bPlanned = false;
+        while (tau * p.dMeanActionTime >= 1.0) {
+            bPlanned = plan_leap<Policy>(tau, going);
+            if (bPlanned) break;
+            tau *= 0.5;
+        }
+
+        // Leaps too short for workers to act even once save nothing over single actions:
+        // exact steps over the mean time of one action per worker, then bounds are redone
+        if (!bPlanned) {
+            const double t_end = std::min(ctx.gtime + 1.0 / p.dMeanActionTime, ctx.max_gtime_evolution);
+            while (ctx.gtime < t_end && !nests.empty()) {
+                const double num_workers = static_cast<double>(nests.size()) * p.iNumWorkers;
+                const double t_next = ctx.gtime + exponential(ctx.rn, num_workers * p.dMeanActionTime);
+                if (!system_queue.empty() && system_queue.top().time <= t_next) {
+                    if (system_queue.top().time >= ctx.max_gtime_evolution) return;
+                    fire_system_event<Policy>(evolution_file, dn_file);
+                    continue;
                 }
-                cnt_rentry++;           //LC
-                nests[cnestindex].nrentry++;
-                // Success or No success, simply add back to colony
-                current.bIsGoing = true;
+                direct_step<Policy>(t_next);
+                if (bDebugStorer) check_storer();
+                tlastregen = ctx.gtime;
             }
-            // std::cout << "Nest ID: " << current.nest_id << ", Individual ID: " << current.ind_id 
-            // << ", t_birth: " << current.t_birth << ", t_next: " << current.t_next << ", Go: " << current.bIsGoing << ", Steal: " << !current.bForage  << std::endl;
-            // std::cout << cnt_sucrentry << "/" << cnt_sucfood << "  Res|Int  " << cnt_sucsteal << "/" << cnt_steal;  //LC
-            // std::cout << "   For:" << cnt_sucforage << "   Rer:" << cnt_rentry << "   Go:" << cnt_forage;
-            // std::cout << "   PopSt:" << PopStock << std::endl;
-            event_queue.push(current);
-            check_nests(cnestid);
+            continue;
+        }
+
+        apply_leap(tau);
+        regenerate_food();                      // Regenerate pop stock over the leap
+
+        // Nests that ran out of food die at the end of the leap, going backwards
+        // so the nest swapped in by a kill has been checked already
+        for (size_t i = nests.size(); i-- > 0; ) {
+            if (i < nests.size()) check_nests<Policy>(i);
         }
+
+        if (bDebugStorer) check_storer();
         // Last action time of population assigned to tlastregen
-        tlastregen = gtime;
+        tlastregen = ctx.gtime;
     }
-    // Output last point of output
-    printLastPopulationState(p.params_to_record,fs_file);
-    fs_file.close();
-    evolution_file.close();
-    dn_file.close();
 }
 
-// Function to check nest ID for negative food
+// Function to find length of next tau leap, given number of workers heading out
+// Bounded by dTauLeap, by the next housekeeping event and so that expected use of
+// population stock and expected losses of every nest stay below dLeapStockFrac of them
+double Population::leap_length(const double going) const {
+    const double rate = p.dMeanActionTime;
+    const double others = static_cast<double>(nests.size() - 1);
+    const double leave_rate = rate * going;
+    const double stock = std::max(PopStock, 0.0);
+    double tau = std::numeric_limits<double>::infinity();
+
+    // Forage rate is leave_rate * stock / (stock + others), constant stock is never used up
+    if (leave_rate > 0.0 && stock > 0.0 && p.iConstStockChoice != 1) {
+        tau = p.dLeapStockFrac * (stock + others) / leave_rate;
+    }
+    // Losses of nests: metabolic cost of every action plus raids, all raids counted as successful
+    const double raid_rate = (others > 0.0) ? leave_rate / (stock + others) : 0.0;
+    for (size_t i = 0; i < nests.size(); ++i) {
+        double loss = rate * p.iNumWorkers * p.dMetabolicCost * nests[i].TotalAbundance / 2000.0 / static_cast<double>(p.iNumWorkers);
+        loss += raid_rate - p.dRateNestStock;
+        if (loss > 0.0) {
+            tau = std::min(tau, p.dLeapStockFrac * std::max(storer_stocks[i], 0.0) / loss);
+        }
+    }
+
+    tau = std::min(tau, p.dTauLeap);
+    if (!system_queue.empty()) {
+        tau = std::min(tau, system_queue.top().time - ctx.gtime);
+    }
+    return tau;
+}
+
+// Function to draw all actions of a leap of length tau into leap_plan and leap_workers
+// Returns false, leaving the population untouched, if a nest would end the leap below zero stock
+template <typename Policy>
+bool Population::plan_leap(const double tau, const double going) {
+    // Forage probability at the estimated mid point of the leap, as food is used up during it
+    const double others = static_cast<double>(nests.size() - 1);
+    double pforage = 1.0;
+    if (others > 0.0) {
+        double stock = std::max(PopStock, 0.0);
+        // Constant stock (iConstStockChoice 1) is restored after every action, so it is not used up
+        if (p.iConstStockChoice != 1) stock -= 0.5 * tau * p.dMeanActionTime * going * stock / (stock + others);
+        pforage = stock / (stock + others);
+    }
+
+    leap_plan.assign(nests.size(), NestLeap{});
+    leap_workers.clear();
+    for (size_t i = 0; i < nests.size(); ++i) {
+        plan_nest<Policy>(i, tau, pforage);
+    }
+
+    const double t_end = ctx.gtime + tau;
+    for (size_t i = 0; i < nests.size(); ++i) {
+        const NestLeap& plan = leap_plan[i];
+        const double stock = nests[i].NestStock + nests[i].metabolic_change(p, t_end, plan.actions) + plan.reentries - plan.sucraids;
+        if (stock < 0.0) return false;
+    }
+    return true;
+}
+
+// Function to draw the actions of the workers of nest at index within one leap of length tau
+// Nest acts a poisson number of times, split over its workers as a multinomial, and every
+// worker alternates between leaving and returning, forages and successful re-entries of its
+// trips are binomial counts. Steals of every worker are split over the other nests as a
+// multinomial, and each target lets in a binomial number of them, judged on that worker's cues
+// Work is O(min(actions, workers) + steals)
+template <typename Policy>
+void Population::plan_nest(const size_t nestIndex, const double tau, const double pforage) {
+    const Nest& nest = nests[nestIndex];
+    NestLeap& plan = leap_plan[nestIndex];
+    plan.actions = poisson(ctx.rn, tau * p.dMeanActionTime * nest.NestWorkers.size());
+
+    split_uniform(ctx.rn, plan.actions, nest.NestWorkers.size(), leap_draws, [&](const size_t w, int k) {
+        auto&& ind = nest.NestWorkers[w];
+        bool bGoing = ind.bIsGoing;
+        bool bFood = ind.bSuccesfulFood;
+        int ind_foodreturns = 0;
+
+        // Worker outside heads home first
+        if (!bGoing) {
+            --k;
+            ++plan.returns;
+            if (bFood) ++ind_foodreturns;
+            bGoing = true;
+        }
+
+        // Rest are trips out and back home, and one trip left unfinished if k is odd
+        const int trips = k / 2;
+        const bool unfinished = (k % 2 == 1);
+        const int forage_trips = (trips > 0) ? binom(ctx.rn, trips, pforage) : 0;
+        const bool forage_last = unfinished && bernoulli(ctx.rn, pforage);
+        const int ind_steals = trips - forage_trips + (unfinished && !forage_last);
+        plan.returns += trips;
+        plan.leaves += k - trips;
+        plan.forages += forage_trips + forage_last;
+        plan.steals += ind_steals;
+        ind_foodreturns += forage_trips;            // Stolen food is never carried home
+
+        if (unfinished) {
+            bGoing = false;
+            bFood = forage_last;
+        }
+        if (ind_foodreturns > 0) {
+            plan.foodreturns += ind_foodreturns;
+            plan.reentries += binom(ctx.rn, ind_foodreturns, nest.template reentry_prob<Policy::model, Policy::tol>(ctx, ind));
+        }
+        leap_workers.push_back(WorkerLeap{nestIndex, w, bGoing, bFood});
+
+        // Steals go to uniformly chosen other nests, c indexes the nests without this one
+        split_uniform(ctx.rn, ind_steals, nests.size() - 1, leap_targets, [&](const size_t c, const int raids) {
+            const size_t target = (c < nestIndex) ? c : c + 1;
+            const double accept = nests[target].template intruder_prob<Policy::model, Policy::tol>(ctx, ind.IndiCues);
+            const int accepted = binom(ctx.rn, raids, accept);
+            leap_plan[target].raids += raids;
+            leap_plan[target].sucraids += accepted;
+            plan.sucsteals += accepted;
+        });
+    });
+}
+
+// Function to apply the leap drawn by plan_leap, moving the clock to its end
+void Population::apply_leap(const double tau) {
+    ctx.gtime += tau;                           // Jump to end of leap, metabolic cost uses it
+    for (const auto& leap : leap_workers) {
+        Nest& nest = nests[leap.nest];
+        auto&& ind = nest.NestWorkers[leap.worker];
+        const int returning = static_cast<int>(!leap.bGoing) - static_cast<int>(!ind.bIsGoing);
+        nest.num_returning += returning;
+        pop_num_returning += returning;
+        ind.bIsGoing = leap.bGoing;
+        ind.bSuccesfulFood = leap.bFood;
+    }
+
+    for (size_t i = 0; i < nests.size(); ++i) {
+        Nest& nest = nests[i];
+        const NestLeap& plan = leap_plan[i];
+        nest.metabolic_cost(p, ctx, plan.actions);
+        nest.NestStock += plan.reentries - plan.sucraids;
+        update_storer(i);
+        PopStock -= plan.forages;
+
+        nest.nactions += plan.actions;
+        nest.nleave += plan.leaves;
+        nest.nsucforage += plan.forages;
+        nest.nsteal += plan.steals;
+        nest.nsucsteal += plan.sucsteals;
+        nest.nrentry += plan.returns;
+        nest.nsucfood += plan.foodreturns;
+        nest.nsucrentry += plan.reentries;
+        nest.nraids += plan.raids;
+        nest.nsucraids += plan.sucraids;
+        cnt_leave += plan.leaves;
+        cnt_sucforage += plan.forages;
+        cnt_steal += plan.steals;
+        cnt_sucsteal += plan.sucsteals;
+        cnt_rentry += plan.returns;
+        cnt_sucfood += plan.foodreturns;
+        cnt_sucrentry += plan.reentries;
+    }
+}
+
+// Function to perform one action of worker at index cindindex in nest at index
+// Leaving workers forage or steal, returning workers try to re-enter their nest
+// Returns index of the nest afterwards, since killing a steal target can move it
+template <typename Policy>
+size_t Population::perform_action(size_t cnestindex, const size_t cindindex) {
+    const NestHandle handle = nests[cnestindex].handle;
+    // current returns the current individual, a reference or a view depending on WORKER_LAYOUT
+    auto current = [&]() -> decltype(auto) { return nests[cnestindex].NestWorkers[cindindex]; };
+    nests[cnestindex].metabolic_cost(p, ctx);                // Subtract metabolic burden and regenerate
+    update_storer(cnestindex);
+    nests[cnestindex].nactions++;
+
+    // Check whether in colony or out
+    if (current().bIsGoing) {
+        // If outside colony, check whether foraging or steal
+        int target_nest_index = target_nest(current(), cnestindex);
+        // If foraging
+        nests[cnestindex].nleave++;
+        cnt_leave++;     
+        if (current().bForage) {
+            PopStock -= 1.0;            // Reduce population stock size
+            current().bSuccesfulFood = true;
+            cnt_sucforage++;
+            nests[cnestindex].nsucforage++;
+        } else {
+            // If stealing
+            // Check if intrusion is successful
+            bool success = nests[target_nest_index].template check_Intruder<Policy::model, Policy::tol>(ctx, current().IndiCues);
+            cnt_steal++;   
+            nests[cnestindex].nsteal++;
+            nests[target_nest_index].nraids++;
+
+            // if successful in stealing
+            if (success) {
+                nests[target_nest_index].NestStock -= 1.0;
+                update_storer(target_nest_index);
+                current().bSuccesfulFood = true;
+                nests[target_nest_index].nsucraids++;
+                check_nests<Policy>(target_nest_index);
+                // Killing the target can move the current nest in nests vector
+                cnestindex = slots.resolve(handle);
+                cnt_sucsteal++; 
+                nests[cnestindex].nsucsteal++;
+            }
+            current().bSuccesfulFood = false;
+        }
+        // Action done, change to incoming
+        current().bIsGoing = false;
+        nests[cnestindex].num_returning++;
+        pop_num_returning += 1.0;
+    } else {
+        // If returning to colony, check whether successful or not
+        if (current().bSuccesfulFood) {
+            // Returning with food, resident check
+            bool greatEntry = nests[cnestindex].template check_Resident<Policy::model, Policy::tol>(ctx, current());
+            cnt_sucfood++;
+            nests[cnestindex].nsucfood++;
+            if (greatEntry) {
+                nests[cnestindex].NestStock += 1.0;
+                update_storer(cnestindex);
+                cnt_sucrentry++;           
+                nests[cnestindex].nsucrentry++;
+            }
+        }
+        cnt_rentry++;           //LC
+        nests[cnestindex].nrentry++;
+        // Success or No success, simply add back to colony
+        current().bIsGoing = true;
+        nests[cnestindex].num_returning--;
+        pop_num_returning -= 1.0;
+    }
+    return cnestindex;
+}
+
+// Function to check nest at index for negative food
 // Kill nest if negative food is found
-void Population::check_nests(const unsigned int nestId) {
-    int nest_index = findIndexByNestId(nestId);
-    if (storer_stocks[nest_index] < 0.0) {
-        kill_nest(nestId);
+template <typename Policy>
+void Population::check_nests(const size_t nestIndex) {
+    if (storer_stocks[nestIndex] < 0.0) {
+        kill_nest<Policy>(nestIndex);
     }
 }
 
 // Function to regenerate food as per model choice
+// Tick based reset (iConstStockChoice 2) is a food_tick system event instead
 void Population::regenerate_food(){
     if(p.iConstStockChoice == 1) {
         PopStock = p.dConstantPopStock;
@@ -322,22 +866,69 @@ void Population::regenerate_food(){
         if (PopStock < 0.0) {
             PopStock = 0.0;
         }
-        PopStock += (gtime - tlastregen)*p.dRatePopStock;
-    } else if (p.iConstStockChoice == 2) {
-        if (gtime - last_TickUpdate_time < p.dTickTime) {
-            return; // Skip removal if not enough time has passed
-        }
+        PopStock += (ctx.gtime - tlastregen)*p.dRatePopStock;
+    }
+}
+
+// Function to put the first occurrence of every housekeeping event in system_queue
+// Each event schedules its next occurrence when it fires
+void Population::schedule_system_events() {
+    system_queue.push({ctx.dRemovalTime, SystemEvent::mass_kill});
+    system_queue.push({ctx.dRemovalTime, SystemEvent::mass_reproduce});
+    system_queue.push({ctx.dFracResetSteal*ctx.max_gtime_evolution, SystemEvent::reset_counters});
+    system_queue.push({ctx.dOutputTime, SystemEvent::output_state});
+    system_queue.push({ctx.dOutputTime, SystemEvent::output_deadnests});
+    if (p.iConstStockChoice == 2) {
+        system_queue.push({p.dTickTime, SystemEvent::food_tick});
+    }
+}
+
+// Function to fire the earliest housekeeping event at its exact scheduled time
+template <typename Policy>
+void Population::fire_system_event(std::ostream& evolution_file, std::ostream& dn_file) {
+    system_time next_event = system_queue.top();
+    system_queue.pop();
+    ctx.gtime = next_event.time;
+    regenerate_food();
+    tlastregen = ctx.gtime;
+
+    switch (next_event.type)
+    {
+    case SystemEvent::mass_kill:
+        mass_kill<Policy>();
+        system_queue.push({ctx.gtime + ctx.dRemovalTime, next_event.type});
+        break;
+    case SystemEvent::mass_reproduce:
+        mass_reproduce<Policy>();
+        system_queue.push({ctx.gtime + ctx.dRemovalTime, next_event.type});
+        break;
+    case SystemEvent::reset_counters:
+        reset_counters();
+        break;
+    case SystemEvent::output_state:
+        printPopulationState(p.params_to_record, evolution_file);
+        system_queue.push({ctx.gtime + ctx.dOutputTime, next_event.type});
+        break;
+    case SystemEvent::output_deadnests:
+        printDeadNestsData(p.params_to_record, dn_file);
+        system_queue.push({ctx.gtime + ctx.dOutputTime, next_event.type});
+        break;
+    case SystemEvent::food_tick:
         PopStock = p.dInitFoodStock;
-        last_TickUpdate_time = gtime;
+        system_queue.push({ctx.gtime + p.dTickTime, next_event.type});
+        break;
     }
+    if (bDebugStorer) check_storer();
 }
 
 // Function to find foraging or which nest to steal from
 // based on population stock of food left and num colonies alive
-int Population::target_nest(Individual& indi){
+// Returns index of target nest in nests vector, -1 if foraging
+template <typename Worker>
+int Population::target_nest(Worker&& indi, const size_t nestIndex){
     double num = static_cast<double>(nests.size() - 1);
     double denom = static_cast<double>(PopStock + nests.size() - 1);
-    bool decision = bernoulli(num/denom);
+    bool decision = bernoulli(ctx.rn, num/denom);
     // Take bernoulli of fraction
     if (!decision) {
         indi.bForage = true;
@@ -345,161 +936,279 @@ int Population::target_nest(Individual& indi){
     } else {
         // Stealing from other colony
         indi.bForage = false;
-        int target_nest = indi.nest_id;
-        std::vector<double> dumvec(nests.size(), 1.0);
-        // Ensure target colony isnt the same
-        while (target_nest == indi.nest_id) {
-            target_nest = storer_nest_id[chooseProbableIndex(dumvec)];
-        }
-        return target_nest;
+        // Uniform over the other colonies, never draws the own colony
+        // sample_excluding can replace this once targets get weights
+        return static_cast<int>(uni_int_excluding(ctx.rn, nests.size(), nestIndex));
     }
 }
 
-// Function to loop through nests and update the
-// storer vectors to avoid mismatch
-void Population::update_storer(){
-
-    // dummy variables
-    std::vector<unsigned int> dummy_nest_id;
-    std::vector<double> dummy_stocks; 
+// Function to update the storer stock of nest at index
+// Called after every change of NestStock, births and deaths update storers themselves
+void Population::update_storer(const size_t nestIndex){
+    storer_stocks[nestIndex] = nests[nestIndex].NestStock;
+    if (bTrackMotherWeights) mother_weights.set(nestIndex, storer_stocks[nestIndex]);
+}
 
-    // Push values to dummy storers
-    for (auto& curnest : nests) {
-        dummy_nest_id.push_back(curnest.nest_id);
-        dummy_stocks.push_back(curnest.NestStock);
+// Debug function to loop through nests and check that
+// the storer vectors have not gone out of sync
+void Population::check_storer() const {
+    if (storer_nest_id.size() != nests.size() || storer_stocks.size() != nests.size()) {
+        throw std::runtime_error("Storer size does not match nests");
+    }
+    for (size_t i = 0; i < nests.size(); ++i) {
+        if (storer_nest_id[i] != nests[i].nest_id || storer_stocks[i] != nests[i].NestStock) {
+            throw std::runtime_error("Storer out of sync with nest " + std::to_string(nests[i].nest_id));
+        }
+        if (slots.resolve(nests[i].handle) != static_cast<int>(i)) {
+            throw std::runtime_error("Slot map out of sync with nest " + std::to_string(nests[i].nest_id));
+        }
+        if (bTrackMotherWeights && mother_weights.weight(i) != sampling_weight(storer_stocks[i])) {
+            throw std::runtime_error("Mother weights out of sync with nest " + std::to_string(nests[i].nest_id));
+        }
+    }
+    // Running sums only differ from a fresh sum by rounding
+    std::vector<double> sums(p.iNumCues, 0.0);
+    double workers = 0.0;
+    for (const auto& nest : nests) {
+        for (const auto& worker : nest.NestWorkers) {
+            for (size_t i = 0; i < p.iNumCues; ++i) sums[i] += worker.IndiCues[i];
+            workers += 1.0;
+        }
+    }
+    if (workers != pop_num_workers) throw std::runtime_error("Population worker count out of sync");
+    double returning = 0.0;
+    for (const auto& nest : nests) {
+        int nest_returning = 0;
+        for (const auto& worker : nest.NestWorkers) nest_returning += !worker.bIsGoing;
+        if (nest_returning != nest.num_returning) throw std::runtime_error("Returning workers out of sync in nest " + std::to_string(nest.nest_id));
+        returning += nest_returning;
+    }
+    if (returning != pop_num_returning) throw std::runtime_error("Population returning worker count out of sync");
+    for (size_t i = 0; i < p.iNumCues; ++i) {
+        if (std::abs(sums[i] - pop_cue_sums[i]) > 1e-9 * std::max(1.0, sums[i])) {
+            throw std::runtime_error("Population cue sums out of sync at cue " + std::to_string(i));
+        }
     }
+    // Running nest value sums and lineage counts against a fresh count
+    RunningStats intercepts, slopes, cueabun, ntrlcueabun, offsprings;
+    std::vector<unsigned int> lineages(lineage_counts.size(), 0);
+    int num_lins = 0;
+    for (const auto& nest : nests) {
+        intercepts.add(nest.TolIntercept);
+        slopes.add(nest.TolSlope);
+        cueabun.add(nest.TotalAbundance);
+        ntrlcueabun.add(nest.NtrlTotalAbundance);
+        offsprings.add(nest.num_offsprings);
+        if (nest.lineage_id >= lineages.size() || lineages[nest.lineage_id]++ == 0) ++num_lins;
+    }
+    if (lineages != lineage_counts || num_lins != num_lineages) throw std::runtime_error("Lineage counts out of sync");
+    auto check_moments = [&](const RunningStats& running, const RunningStats& fresh, const char* name) {
+        if (running.count != fresh.count || std::abs(running.mean - fresh.mean) > 1e-9 * std::max(1.0, std::abs(fresh.mean)) ||
+            std::abs(running.m2 - fresh.m2) > 1e-9 * std::max(1.0, fresh.m2)) {
+            throw std::runtime_error(std::string("Running moments of ") + name + " out of sync");
+        }
+    };
+    check_moments(pop_intercepts, intercepts, "TolIntercept");
+    check_moments(pop_slopes, slopes, "TolSlope");
+    check_moments(pop_cueabun, cueabun, "TotalAbundance");
+    check_moments(pop_ntrlcueabun, ntrlcueabun, "NtrlTotalAbundance");
+    check_moments(pop_offsprings, offsprings, "num_offsprings");
+    // Running pairwise sums against a fresh computation
+    auto check_pair_sums = [&](const PairwiseSums& running, const auto& profile_of, const char* name) {
+        std::vector<double> profiles;
+        for (const auto& nest : nests) {
+            const auto& profile = profile_of(nest);
+            profiles.insert(profiles.end(), profile.begin(), profile.end());
+        }
+        const auto fresh = pairwise_bray_curtis_exact(profiles, p.iNumCues);
+        const auto kept = running.mean_std();
+        if (running.size() != nests.size() || (nests.size() > 1 &&
+            (std::abs(std::get<0>(fresh) - std::get<0>(kept)) > 1e-9 || std::abs(std::get<1>(fresh) - std::get<1>(kept)) > 1e-6))) {
+            throw std::runtime_error(std::string("Running pairwise sums of ") + name + " out of sync");
+        }
+    };
+    if (p.iBCNestChoice == 2) check_pair_sums(nest_pair_sums, [](const Nest& nest) -> const cue_profile_t& { return nest.NestMean; }, "NestMean");
+    if (p.iBCNtrlChoice == 2) check_pair_sums(ntrl_pair_sums, [](const Nest& nest) -> const cue_profile_t& { return nest.NtrlCues; }, "NtrlCues");
+}
+
 
-    // Assign values
-    storer_stocks = dummy_stocks;
-    storer_nest_id = dummy_nest_id;
+// Function to register the nest just added at the back of nests vector
+// Gives it a slot handle so its events can find it in O(1) and adds it to storers and pop sums
+void Population::register_nest() {
+    nests.back().handle = slots.acquire(nests.size() - 1);
+    update_pop_sums(nests.back(), 1.0);
+    storer_nest_id.push_back(nests.back().nest_id);
+    storer_stocks.push_back(nests.back().NestStock);
+    if (bTrackMotherWeights) {
+        if (mother_weights.size() < nests.size()) mother_weights.resize(nests.size());
+        mother_weights.set(nests.size() - 1, storer_stocks.back());
+    }
+}
 
+// Function to add an offspring of nest at MotherIndex to the back of nests vector
+// Takes the storage of a dead nest from spare_nests if there is one
+void Population::emplace_offspring(const size_t MotherIndex) {
+    if (spare_nests.empty()) {
+        nests.emplace_back(nest_id_counter, p, ctx, nests[MotherIndex]);
+    } else {
+        spare_nests.back().recycle(nest_id_counter, p, ctx, nests[MotherIndex]);
+        nests.push_back(std::move(spare_nests.back()));
+        spare_nests.pop_back();
+    }
 }
 
+// Function to remove nest at index from nests vector
+// The nest itself moves to spare_nests for reuse by reproduction
+// remove_from_vec moves the last nest into the freed index, so its slot is relocated
+// storers are removed the same way to stay aligned with nests
+// Pending events of the nest are dropped by the scheduler where it supports it
+void Population::erase_nest(const size_t nestIndex) {
+    event_queue->cancel_nest(nests[nestIndex].handle);
+    slots.release(nests[nestIndex].handle);
+    update_pop_sums(nests[nestIndex], -1.0);
+    spare_nests.push_back(std::move(nests[nestIndex]));
+    remove_from_vec(nests, nestIndex);
+    remove_from_vec(storer_nest_id, nestIndex);
+    remove_from_vec(storer_stocks, nestIndex);
+    if (bTrackMotherWeights) {
+        // Same move as remove_from_vec: last weight into the freed index, last index emptied
+        if (nestIndex < nests.size()) mother_weights.set(nestIndex, storer_stocks[nestIndex]);
+        mother_weights.set(nests.size(), 0.0);
+    }
+    if (nestIndex < nests.size()) {
+        slots.relocate(nests[nestIndex].handle, nestIndex);
+    }
+}
 
-// Function to find index of a particular Nest ID in nests vector
-// By searching in the storer nest ID vector 
-int Population::findIndexByNestId(unsigned int nestId) {
-    auto it = std::find(storer_nest_id.begin(), storer_nest_id.end(), nestId);
-    if (it != storer_nest_id.end()) {
-        return static_cast<int>(std::distance(storer_nest_id.begin(), it));
+// Function to record nest at index, about to die, for the dead nests file
+// Takes no random number if no dead nests are recorded
+void Population::record_dead_nest(const size_t nestIndex) {
+    if (ctx.dFracDeadNest <= 0.0 || !bernoulli(ctx.rn, ctx.dFracDeadNest)) return;
+    if (num_dead < deadNests.size()) {
+        deadNests[num_dead].assign(nests[nestIndex]);
     } else {
-        return -1;  // Return -1 if nest_id is not found
+        deadNests.emplace_back(nests[nestIndex]);
     }
+    ++num_dead;
 }
 
-// Function to kill a particular nest ID from nests vector
-// and also from storer_nest_id vector
-void Population::kill_nest(const unsigned int nestID) {
-    int nestIndex = findIndexByNestId(nestID);    // Find index of nest in storer and nests vector
-    if(bernoulli(dFracDeadNest)) {
-        deadNests.push_back(nests[nestIndex]);    // Push to deadNests vector
+// Function to write out a full dead nests buffer, called once a kill has finished
+// so that the population sums behind popavg_dist are complete
+void Population::spill_dead_nests() {
+    if (num_dead >= iDeadNestBuffer && dead_nest_file != nullptr) {
+        printDeadNestsData(p.params_to_record, *dead_nest_file);
     }
-    remove_from_vec(nests, nestIndex);            // Remove from nest
-    update_storer();
+}
+
+// Function to kill nest at a particular index from nests vector
+// and also from storer_nest_id vector
+template <typename Policy>
+void Population::kill_nest(const size_t nestIndex) {
+    record_dead_nest(nestIndex);                  // Record for dead nests file
+    erase_nest(nestIndex);                        // Remove from nest
 
     // Since we also call kill_nest when food runs low
     // if mass reproduction is not allowed, then produce 1 colony at the same time
-    if (p.iRepChoice == 1 || p.iRepChoice == 2) {
+    if constexpr (Policy::bIndividualRep) {
         reproduce_nest();
     }
+    spill_dead_nests();
 }
 
-// Function to remove a particular nest ID from nests vector
-// used in masskill
-void Population::remove_nest(const unsigned int nestID) {
-    int nestIndex = findIndexByNestId(nestID);    // Find index of nest in storer and nests vector
-    if(bernoulli(dFracDeadNest)) {
-        deadNests.push_back(nests[nestIndex]);    // Push to deadNests vector
+// Function to remove all nests marked in kill_marks, used in mass kill
+// Survivors are compacted towards the front of nests in a single pass,
+// storers, slot map and mother weights follow them, dead nests go to spare_nests
+void Population::remove_marked_nests() {
+    size_t write = 0;
+    for (size_t read = 0; read < nests.size(); ++read) {
+        if (kill_marks[read]) {
+            record_dead_nest(read);
+            event_queue->cancel_nest(nests[read].handle);
+            slots.release(nests[read].handle);
+            update_pop_sums(nests[read], -1.0);
+            spare_nests.push_back(std::move(nests[read]));
+            continue;
+        }
+        if (write != read) {
+            nests[write] = std::move(nests[read]);
+            storer_nest_id[write] = storer_nest_id[read];
+            storer_stocks[write] = storer_stocks[read];
+            slots.relocate(nests[write].handle, write);
+        }
+        ++write;
     }
-
-    remove_from_vec(nests, nestIndex);            // Remove from nest
-    update_storer();
+    nests.erase(nests.begin() + write, nests.end());
+    storer_nest_id.resize(write);
+    storer_stocks.resize(write);
+    if (bTrackMotherWeights) mother_weights.assign(storer_stocks);
+    spill_dead_nests();
 }
 
 // Function to look at current food stocks, and take those as the viability
 // potentials of nests, and one nest reproduces
 void Population::reproduce_nest() {
-    int MotherIndex = chooseProbableIndex(storer_stocks);
-    int MotherNID = storer_nest_id[MotherIndex];
+    int MotherIndex = mother_weights.sample(ctx.rn);
 
     if (nests.size() < p.iNumColonies) { 
-        // Memory location of mother nest stored in mom_nest
-        Nest& mom_nest{nests[MotherIndex]};
         // Reproduce
-        nests.emplace_back(nest_id_counter, p, mom_nest);
+        emplace_offspring(MotherIndex);
+        register_nest();
         ++nest_id_counter;
 
-        // Add new individuals to event queue
-        for (auto ind : nests.back().NestWorkers){
-            event_queue.push(track_time(ind));
-        }
+        // Add new individuals to event queue in one go
+        event_queue->push_nest(nests.back());
 
         // Increase mother offspring count
-        mom_nest.num_offsprings++;
+        // Indexed again since emplace_offspring may have reallocated nests
+        add_offspring(MotherIndex);
     }
-    update_storer();
 }
 
 // Reproduces in mass right after mass kill
+template <typename Policy>
 void Population::mass_reproduce() {
-    // Check last mass reproduce time
-    if (gtime - last_MassRep_time < dRemovalTime) {
-        return; // Skip removal if not enough time has passed
-    }
-
     // Mass reproduction is done
-    if (p.iRepChoice == 0 || p.iRepChoice == 2) {
+    if constexpr (Policy::bMassRep) {
         int num_currentNests = nests.size();
+        // Mothers are drawn from nests alive before this round only
+        mass_mothers.build(storer_stocks);
         while (num_currentNests < p.iNumColonies) {
-            int MotherIndex = chooseProbableIndex(storer_stocks);
-            int MotherNID = storer_nest_id[MotherIndex];
-            Nest& mom_nest{nests[MotherIndex]};
+            int MotherIndex = mass_mothers.sample(ctx.rn);
             // Reproduce
-            nests.emplace_back(nest_id_counter, p, mom_nest);
+            emplace_offspring(MotherIndex);
+            register_nest();
             ++nest_id_counter;
             num_currentNests = nests.size();
-            mom_nest.num_offsprings++;
+            add_offspring(MotherIndex);
 
-            // Add new workers to event queue
-            for (auto ind : nests.back().NestWorkers){
-                event_queue.push(track_time(ind));
-            }
+            // Add new workers to event queue in one go
+            event_queue->push_nest(nests.back());
         }
         if (p.iFoodResetChoice == 1) {
-            for (auto& nest : nests) {
-                nest.NestStock = p.dInitNestStock;
+            for (size_t i = 0; i < nests.size(); ++i) {
+                nests[i].NestStock = p.dInitNestStock;
+                update_storer(i);
             }
             PopStock = p.dInitFoodStock;
         }
-        update_storer();
     }
-    last_MassRep_time = gtime;
 }
 
 // Mass kill function. Depending on value of iKillChoice
 // Does random kill, sorted kill or NO kill
+template <typename Policy>
 void Population::mass_kill() {
-    // Check last mass kill time
-    if (gtime - last_MassKill_time < dRemovalTime) {
-        return; // Skip removal if not enough time has passed
-    }
-
-    // Implement choice of killing
-    if (p.iKillChoice == 0) {
-        random_kill();
-    } else if (p.iKillChoice == 1) {
-        sorted_kill();
-    } else if (p.iKillChoice == 2) {
-        int dummyVar = 0;
-    } else {
-        throw std::runtime_error("Wrong choice of iKillChoice");
+    // Implement choice of killing, iKillChoice 2 kills nothing
+    if constexpr (Policy::kill == 0) {
+        random_kill<Policy>();
+    } else if constexpr (Policy::kill == 1) {
+        sorted_kill<Policy>();
     }
-
-    last_MassKill_time = gtime;             // Update last massKill time
 }
 
 // implicit function called in mass kill
 // Implements random kill
+template <typename Policy>
 void Population::random_kill() {
     // Calculate number of colonies to be killed
     int alreadyDead = p.iNumColonies - nests.size();
@@ -507,21 +1216,28 @@ void Population::random_kill() {
 
     // In case we have individual and mass reproduction both
     // then toKill is simply fracKilled x numColonies
-    if (p.iRepChoice == 2) {
+    if constexpr (Policy::rep == 2) {
         toKill = floor(p.dFracKilled*p.iNumColonies);
     }
 
-    // Take random subset of nestIDs and kill
+    // Take random subset of nests by a partial Fisher-Yates shuffle of indexes and kill
     if (toKill > 0) {
-        auto toKillNestIDs = randomSubset(storer_nest_id, toKill);
-        for (int i = 0; i < toKill; i++) {
-            remove_nest(toKillNestIDs[i]);
+        const size_t numNests = nests.size();
+        const size_t numKill = std::min(static_cast<size_t>(toKill), numNests);
+        kill_order.resize(numNests);
+        std::iota(kill_order.begin(), kill_order.end(), 0);
+        kill_marks.assign(numNests, 0);
+        for (size_t i = 0; i < numKill; i++) {
+            std::swap(kill_order[i], kill_order[uni_int(ctx.rn, i, numNests)]);
+            kill_marks[kill_order[i]] = 1;
         }
+        remove_marked_nests();
     }
 }
 
 // implicit function called in mass kill
 // Implements sorted kill
+template <typename Policy>
 void Population::sorted_kill() {
     // Calculate number of colonies to be killed
     int alreadyDead = p.iNumColonies - nests.size();
@@ -529,40 +1245,31 @@ void Population::sorted_kill() {
 
     // In case we have individual and mass reproduction both
     // then toKill is simply fracKilled x numColonies
-    if (p.iRepChoice == 2) {
+    if constexpr (Policy::rep == 2) {
         toKill = floor(p.dFracKilled*p.iNumColonies);
     }
 
     double threshold_stock = 0.0;
     
     // Find food stock threshold that determines death
+    // nth_element selects the toKill-th lowest stock in linear time
     if (toKill > 0) {
-        auto sorted_stock = storer_stocks;
-        std::sort(sorted_stock.begin(), sorted_stock.end());
-        threshold_stock = sorted_stock[toKill - 1];
+        const size_t numKill = std::min(static_cast<size_t>(toKill), storer_stocks.size());
+        kill_stocks.assign(storer_stocks.begin(), storer_stocks.end());
+        std::nth_element(kill_stocks.begin(), kill_stocks.begin() + (numKill - 1), kill_stocks.end());
+        threshold_stock = kill_stocks[numKill - 1];
         // Kill colonies with food stock lower than threshold food stock
-        auto dummy_nestIDs = storer_nest_id;
-        auto dummy_stocks = storer_stocks;
-
-        // Remove nests using IDs
-        for (int i = 0; i < dummy_stocks.size(); i++) {
-            if (dummy_stocks[i] <= threshold_stock) {
-                remove_nest(dummy_nestIDs[i]);
+        kill_marks.assign(nests.size(), 0);
+        for (size_t i = 0; i < storer_stocks.size(); i++) {
+            if (storer_stocks[i] <= threshold_stock) {
+                kill_marks[i] = 1;
             }
         }
+        remove_marked_nests();
     }
-
-    
 }
 
 void Population::reset_counters() {
-    if (gtime  < dFracResetSteal*max_gtime_evolution && !reset_cnt) {
-        return; 
-    }
-    if (reset_cnt) {
-        return; // 
-    }
-    reset_cnt = true;
     cnt_sucrentry = 0;
     cnt_sucfood = 0;
     cnt_steal = 0;
@@ -574,110 +1281,70 @@ void Population::reset_counters() {
 
 
 void Population::printPopulationState(const std::vector< float >& param_values, std::ostream& csv_file) {
-    if (gtime - last_evolution_time < dOutputTime) {
-        return; // Skip removal if not enough time has passed
-    }
     // evolution_file << "gtime,popstock,popsize,bcnest_avg,bcnest_std,bcind_avg,bcind_std,ntrlbc_avg,ntrlbc_std,uniq_lins,relatedness,int_avg,int_std,slope_avg,slope_std,cueabun_avg,cueabun_std,ntrlabun_avg,ntrlabun_std,steal,sucsteal,leave,sucfor,rentry,sucrentr,sucfood,offprings_avg,offspring_std";
     
     for (auto i : param_values) {
         csv_file << i << ',';
     }
-    gen_stuff = std::make_tuple(gtime, PopStock, nests.size());
+    gen_stuff = std::make_tuple(ctx.gtime, PopStock, nests.size());
     csv_file << std::get<0>(gen_stuff) << "," << std::get<1>(gen_stuff) << "," << std::get<2>(gen_stuff);
     
-    std::vector<std::vector<double>> nestProfiles;
-    std::vector<std::vector<double>> NtrlProfiles;
-    std::vector<std::vector<double>> antProfiles;
-    std::vector<double> lineages;
-    std::vector<double> shannons;
-    std::vector<double> simpsons;
-    std::vector<double> shannonsant;
-    std::vector<double> simpsonsant;
-    std::vector<double> intercepts;
-    std::vector<double> slopes;
-    std::vector<double> cueabun;
-    std::vector<double> ntrlcueabun;
-    std::vector<double> offsprings;
-    std::vector<double> neutral;
-    std::vector<double> time_alive;
-
-    for (auto& nest: nests){
-        nestProfiles.push_back(nest.NestMean);
-        NtrlProfiles.push_back(nest.NtrlCues);
-        for (auto& ant: nest.NestWorkers){
-            antProfiles.push_back(ant.IndiCues);
-            shannonsant.push_back(calculateShannonDiversity({ant.IndiCues}));
-            simpsonsant.push_back(calculateSimpsonDiversity({ant.IndiCues}));
-        }
-        lineages.push_back(nest.lineage_id);
-        shannons.push_back(calculateShannonDiversity({nest.NestMean}));
-        simpsons.push_back(calculateSimpsonDiversity({nest.NestMean}));
-        neutral.push_back(nest.NestNeutralGene);
-        intercepts.push_back(nest.TolIntercept);
-        slopes.push_back(nest.TolSlope);
-        cueabun.push_back(nest.TotalAbundance);
-        ntrlcueabun.push_back(nest.NtrlTotalAbundance);
-        offsprings.push_back(nest.num_offsprings);
-        time_alive.push_back(gtime - nest.tbirth);
-    }
-    // evolution_file << "relatedness,int_avg,int_std,slope_avg,slope_std,cueabun_avg,cueabun_std,ntrlabun_avg,ntrlabun_std,steal,sucsteal,leave,sucfor,rentry,sucrentr,sucfood,offprings_avg,offspring_std";
-    
-    stat_bc_nest = calculatePairwiseBrayCurtis(nestProfiles);
+    // Profiles of each statistic are gathered as rows of stat_profiles, see PairwiseStats.hpp
+    stat_bc_nest = pairwise_stat(p.iBCNestChoice, "iBCNestChoice", &nest_pair_sums, [&]() {
+        for (const auto& nest : nests) {
+            stat_profiles.insert(stat_profiles.end(), nest.NestMean.begin(), nest.NestMean.end());
+        }
+    });
     csv_file << "," << std::get<0>(stat_bc_nest) << "," << std::get<1>(stat_bc_nest);
 
-    stat_bc_ant = calculatePairwiseBrayCurtis(antProfiles);
+    stat_bc_ant = pairwise_stat(p.iBCAntChoice, "iBCAntChoice", nullptr, [&]() {
+        for (const auto& nest : nests) {
+            for (const auto& ant : nest.NestWorkers) {
+                stat_profiles.insert(stat_profiles.end(), ant.IndiCues.begin(), ant.IndiCues.end());
+            }
+        }
+    });
     csv_file << "," << std::get<0>(stat_bc_ant) << "," << std::get<1>(stat_bc_ant);
     
-    stat_bc_ntrlcues = calculatePairwiseBrayCurtis(NtrlProfiles);
+    stat_bc_ntrlcues = pairwise_stat(p.iBCNtrlChoice, "iBCNtrlChoice", &ntrl_pair_sums, [&]() {
+        for (const auto& nest : nests) {
+            stat_profiles.insert(stat_profiles.end(), nest.NtrlCues.begin(), nest.NtrlCues.end());
+        }
+    });
     csv_file << "," << std::get<0>(stat_bc_ntrlcues) << "," << std::get<1>(stat_bc_ntrlcues);
 
-    std::set<double> unique_lineages(lineages.begin(), lineages.end());
-    uniq_lins = unique_lineages.size();
+    uniq_lins = num_lineages;
     csv_file << "," << uniq_lins;
 
-    // stat_shannons = mean_std(shannons);
-    // csv_file << "," << std::get<0>(stat_shannons) << "," << std::get<1>(stat_shannons);
-
-    // stat_simpsons = mean_std(simpsons);
-    // csv_file << "," << std::get<0>(stat_simpsons) << "," << std::get<1>(stat_simpsons);
-
-    // stat_shannonsant = mean_std(shannonsant);
-    // csv_file << "," << std::get<0>(stat_shannonsant) << "," << std::get<1>(stat_shannonsant);
-
-    // stat_simpsonsant = mean_std(simpsonsant);
-    // csv_file << "," << std::get<0>(stat_simpsonsant) << "," << std::get<1>(stat_simpsonsant);
-
     // Calculate relatedness
-    std::vector<double> geneValuesNest1;
-    std::vector<double> geneValuesNest2;
+    related_genes1.clear();
+    related_genes2.clear();
     
     for (const auto& nest : nests) {
-        size_t randomIndex1 = uni_int(0, static_cast<int>(p.iNumWorkers));
+        size_t randomIndex1 = uni_int(ctx.rn, 0, static_cast<int>(p.iNumWorkers));
         size_t randomIndex2;
         do {
-            randomIndex2 = uni_int(0, static_cast<int>(p.iNumWorkers));
+            randomIndex2 = uni_int(ctx.rn, 0, static_cast<int>(p.iNumWorkers));
         } while (randomIndex1 == randomIndex2);
 
-        geneValuesNest1.push_back(nest.NestWorkers[randomIndex1].NeutralGene);
-        geneValuesNest2.push_back(nest.NestWorkers[randomIndex2].NeutralGene);
+        related_genes1.push_back(nest.NestWorkers[randomIndex1].NeutralGene);
+        related_genes2.push_back(nest.NestWorkers[randomIndex2].NeutralGene);
     }
 
-    relatedness = covariance(geneValuesNest1, geneValuesNest2) / (standard_deviation(geneValuesNest1) * standard_deviation(geneValuesNest2));
+    relatedness = covariance(related_genes1, related_genes2) / (standard_deviation(related_genes1) * standard_deviation(related_genes2));
     csv_file << "," << relatedness;
 
-    // stat_neutral = mean_std(neutral);
-    // csv_file << "," << std::get<0>(stat_neutral) << "," << std::get<1>(stat_neutral);
-
-    stat_intercepts = mean_std(intercepts);
+    // Nest values come from running moments, updated on every birth, death and offspring of a nest
+    stat_intercepts = pop_intercepts.mean_std();
     csv_file << "," << std::get<0>(stat_intercepts) << "," << std::get<1>(stat_intercepts);
 
-    stat_slopes = mean_std(slopes);
+    stat_slopes = pop_slopes.mean_std();
     csv_file << "," << std::get<0>(stat_slopes) << "," << std::get<1>(stat_slopes);
 
-    stat_cueabun = mean_std(cueabun);
+    stat_cueabun = pop_cueabun.mean_std();
     csv_file << "," << std::get<0>(stat_cueabun) << "," << std::get<1>(stat_cueabun);
 
-    stat_ntrlcueabun = mean_std(ntrlcueabun);
+    stat_ntrlcueabun = pop_ntrlcueabun.mean_std();
     csv_file << "," << std::get<0>(stat_ntrlcueabun) << "," << std::get<1>(stat_ntrlcueabun);
     
     csv_file << "," << cnt_steal;
@@ -688,22 +1355,12 @@ void Population::printPopulationState(const std::vector< float >& param_values,
     csv_file << "," << cnt_sucrentry;
     csv_file << "," << cnt_sucfood;
 
-    stat_offsprings = mean_std(offsprings);
-    // simp_shan_offspring = std::make_tuple(calculateSimpsonDiversity({offsprings}),calculateShannonDiversity({offsprings}));
+    stat_offsprings = pop_offsprings.mean_std();
     csv_file << "," << std::get<0>(stat_offsprings) << "," << std::get<1>(stat_offsprings);
-    // csv_file << "," << std::get<0>(simp_shan_offspring) << "," << std::get<1>(simp_shan_offspring);
-
-    // stat_time_alive = mean_std(time_alive);
-    // max_min_time = std::make_tuple(*std::max_element(time_alive.begin(), time_alive.end()),*std::min_element(time_alive.begin(), time_alive.end()));
-    // csv_file << "," << std::get<0>(stat_time_alive) << "," << std::get<1>(stat_time_alive);
-    // csv_file << "," << std::get<0>(max_min_time) << "," << std::get<1>(max_min_time);
 
     // End the CSV line
     csv_file << "\n";
     csv_file.flush();
-
-    // Update the last removal time
-    last_evolution_time = gtime;
 }
 
 
@@ -712,7 +1369,7 @@ void Population::printLastPopulationState(const std::vector< float >& param_valu
     for (auto i : param_values) {
         csv_file << i << ',';
     }
-    csv_file << gtime << "," << PopStock << "," << nests.size();
+    csv_file << ctx.gtime << "," << PopStock << "," << nests.size();
     csv_file << "," <<  std::get<0>(gen_stuff) << "," << std::get<1>(gen_stuff) << "," << std::get<2>(gen_stuff);
     csv_file << "," << std::get<0>(stat_bc_nest) << "," << std::get<1>(stat_bc_nest);
     csv_file << "," << std::get<0>(stat_bc_ant) << "," << std::get<1>(stat_bc_ant);
@@ -745,25 +1402,25 @@ void Population::printLastPopulationState(const std::vector< float >& param_valu
 }
 
 void Population::printDeadNestsData(const std::vector< float >& param_values, std::ostream& csv_file){
-    if (gtime - last_deadnest_time < dOutputTime) {
-        return; // Skip removal if not enough time has passed
-    }
     // dn_file << "gtime,tbirth,nest_id,neststock,mom_id,num_steal,num_sucsteal,num_forage,num_sucforage,num_rentry,num_sucrentry,num_raid,num_sucraid,num_actions,int,slope,offspring,neutral_gene,popavg_dist";
     
-    if (deadNests.size() > 0) {
-        for (auto& nest : deadNests) {
-            // -> here
+    if (num_dead > 0) {
+        // Population mean is the same for every record of this output
+        const cue_profile_t pop_avg(calculateMeanProfile());
+        for (size_t d = 0; d < num_dead; ++d) {
+            const DeadNestRecord& nest = deadNests[d];
             for (auto i : param_values) {
                 csv_file << i << ',';
             }
-            csv_file << gtime << "," << nest.tbirth << "," << nest.nest_id << "," << nest.NestStock << ",";
+            csv_file << ctx.gtime << "," << nest.tbirth << "," << nest.nest_id << "," << nest.NestStock << ",";
             csv_file << nest.mom_id << "," << nest.nsteal << "," << nest.nsucsteal << "," << nest.nleave << ",";
             csv_file << nest.nsucforage << "," << nest.nrentry << "," << nest.nsucrentry << "," << nest.nraids << ",";
             csv_file << nest.nsucraids << "," << nest.nactions << "," << nest.TolIntercept << "," << nest.TolSlope << ",";
             csv_file << nest.num_offsprings << "," << nest.NestNeutralGene;
-
-            auto pop_avg = calculateMeanProfile();
-            csv_file << "," << calculateBrayCurtisDistance(nest.NestMean, pop_avg);
+            // Bray Curtis without the throw of gestalt_distance, two empty profiles are at distance 0 as in pair_distance
+            const ProfileSums sums = profile_sums(nest.NestMean, pop_avg);
+            const double total = sums.sum_a + sums.sum_b;
+            csv_file << "," << (total > 0.0 ? 1.0 - 2.0 * sums.shared / total : 0.0);
             
             for (int cue_index = 0; cue_index < p.iNumCues; ++cue_index) {
                 csv_file << "," << nest.NestMean[cue_index]  ;
@@ -771,11 +1428,9 @@ void Population::printDeadNestsData(const std::vector< float >& param_values, st
 
             // End the CSV line
             csv_file << "\n";
-            csv_file.flush();
         }
+        csv_file.flush();
     }
-    deadNests.clear();
-    // Update the last removal time
-    last_deadnest_time = gtime;
+    num_dead = 0;                                   // Records are kept and overwritten
 }
 #endif /* Population_hpp */
\ No newline at end of file
@@ -0,0 +1,81 @@
+//
+//  BenchRandom.cpp
+//  Croziers Paradox
+//
+//  -> Measures raw draws per second of the engines in Random.hpp and of every distribution
+//  -> used in the simulation loop, against the former fresh distribution per call on std::mt19937
+//  -> Compile from main folder: g++ -std=c++2a -O2 ProjectMaintenance/Benchmarks/BenchRandom.cpp -I. -o benchrandom
+//  -> Add -DRNG_ENGINE=0 or 2 to measure the distributions on Philox4x32 or PCG64
+//  -> Last table draws the pooled deviates one per call from the same engine, the difference
+//  -> to the pools is the gain of batching the draws alone
+
+#include "Random.hpp"
+
+const size_t num_draws = 10000000;
+
+// Returns millions of calls of draw per second
+template <typename DrawFn>
+double bench_draws(DrawFn draw) {
+    auto start = std::chrono::high_resolution_clock::now();
+    double checksum = 0.0;
+    for (size_t i = 0; i < num_draws; ++i) {
+        checksum += static_cast<double>(draw());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    static volatile double sink;
+    sink = checksum;                                // Keeps the loop from being optimised away
+    return static_cast<double>(num_draws) / std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+template <typename Engine>
+double bench_engine(Engine engine) {
+    return bench_draws([&engine] { return engine(); });
+}
+
+int main() {
+    std::cout << "engine,Mdraws_per_s" << std::endl;
+    std::cout << "mt19937," << bench_engine(std::mt19937(1)) << std::endl;
+    std::cout << "mt19937_64," << bench_engine(std::mt19937_64(1)) << std::endl;
+    std::cout << "philox4x32," << bench_engine(Philox4x32(1)) << std::endl;
+    std::cout << "xoshiro256pp," << bench_engine(Xoshiro256pp(1)) << std::endl;
+    std::cout << "pcg64," << bench_engine(Pcg64(1)) << std::endl;
+
+    // Parameters match typical calls of the simulation loop
+    rng_t rn(1);
+    std::mt19937 mt(1);
+    std::cout << std::endl << "distribution,former_Mdraws_per_s,current_Mdraws_per_s" << std::endl;
+    std::cout << "bernoulli,"
+              << bench_draws([&] { return std::bernoulli_distribution(0.3)(mt); }) << ","
+              << bench_draws([&] { return bernoulli(rn, 0.3); }) << std::endl;
+    std::cout << "normal,"
+              << bench_draws([&] { return std::normal_distribution<double>(0.0, 0.1)(mt); }) << ","
+              << bench_draws([&] { return normal(rn, 0.0, 0.1); }) << std::endl;
+    std::cout << "uni_real,"
+              << bench_draws([&] { return std::uniform_real_distribution<double>(0.0, 1.0)(mt); }) << ","
+              << bench_draws([&] { return uni_real(rn); }) << std::endl;
+    std::cout << "uni_int,"
+              << bench_draws([&] { return std::uniform_int_distribution<size_t>(0, 49)(mt); }) << ","
+              << bench_draws([&] { return uni_int(rn, static_cast<size_t>(0), static_cast<size_t>(50)); }) << std::endl;
+    std::cout << "exponential,"
+              << bench_draws([&] { return std::exponential_distribution<double>(1.0)(mt); }) << ","
+              << bench_draws([&] { return exponential(rn, 1.0); }) << std::endl;
+    std::cout << "binom,"
+              << bench_draws([&] { return std::binomial_distribution<int>(20, 0.4)(mt); }) << ","
+              << bench_draws([&] { return binom(rn, 20, 0.4); }) << std::endl;
+    std::cout << "poisson,"
+              << bench_draws([&] { return std::poisson_distribution<int>(30.0)(mt); }) << ","
+              << bench_draws([&] { return poisson(rn, 30.0); }) << std::endl;
+
+    // Pooled deviates against one per call on the engine of the pools
+    std::cout << std::endl << "pooled,per_call_Mdraws_per_s,block_Mdraws_per_s" << std::endl;
+    std::cout << "uni_real,"
+              << bench_draws([&] { return std::uniform_real_distribution<double>(0.0, 1.0)(rn.engine); }) << ","
+              << bench_draws([&] { return rn.uniform(); }) << std::endl;
+    std::cout << "normal,"
+              << bench_draws([&] { return std::normal_distribution<double>(0.0, 1.0)(rn.engine); }) << ","
+              << bench_draws([&] { return rn.std_normal(); }) << std::endl;
+    std::cout << "exponential,"
+              << bench_draws([&] { return std::exponential_distribution<double>(1.0)(rn.engine); }) << ","
+              << bench_draws([&] { return rn.std_exponential(); }) << std::endl;
+    return 0;
+}
@@ -0,0 +1,45 @@
+//
+//  BenchScheduler.cpp
+//  Croziers Paradox
+//
+//  -> Compares event schedulers of Scheduler.hpp with the classic "hold" model:
+//  -> pop the earliest event and push it back at t + exponential(1), as workers do in simulate
+//  -> Compile from main folder: g++ -std=c++2a -O2 ProjectMaintenance/Benchmarks/BenchScheduler.cpp -I. -o benchscheduler
+
+#include "Scheduler.hpp"
+
+// Runs hold operations on a scheduler filled with num_events events and returns ns per hold
+double bench_hold(EventScheduler& queue, const size_t num_events, const size_t num_holds) {
+    rng_t rn(1);
+    // Workers are grouped in nests of 10 as in default simulations
+    for (size_t i = 0; i < num_events; ++i) {
+        NestHandle handle{static_cast<unsigned int>(i / 10), 0};
+        queue.push(track_time(exponential(rn, 1.0), handle, static_cast<int>(i % 10)));
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    double checksum = 0.0;
+    for (size_t i = 0; i < num_holds; ++i) {
+        track_time next_event = queue.pop();
+        checksum += next_event.time;
+        next_event.time += exponential(rn, 1.0);
+        queue.push(next_event);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    if (checksum < 0.0) std::cout << checksum;      // Keeps the loop from being optimised away
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(num_holds);
+}
+
+int main() {
+    const size_t num_holds = 2000000;
+    std::cout << "pending_events,heap_ns,nest_ns,calendar_ns" << std::endl;
+    for (size_t num_events = 1000; num_events <= 1000000; num_events *= 10) {
+        HeapScheduler heap;
+        NestScheduler nest;
+        CalendarScheduler calendar;
+        double t_heap = bench_hold(heap, num_events, num_holds);
+        double t_nest = bench_hold(nest, num_events, num_holds);
+        double t_calendar = bench_hold(calendar, num_events, num_holds);
+        std::cout << num_events << "," << t_heap << "," << t_nest << "," << t_calendar << std::endl;
+    }
+    return 0;
+}
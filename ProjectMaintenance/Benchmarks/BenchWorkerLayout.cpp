@@ -0,0 +1,110 @@
+//
+//  BenchWorkerLayout.cpp
+//  Croziers Paradox
+//
+//  -> Compares the worker layouts of Workers.hpp: std::vector<Individual> (WORKER_LAYOUT=0)
+//  -> against WorkerColumns (WORKER_LAYOUT=1) on the worker accesses of the simulation loop
+//  ->   resident: check_Resident of model 4, a random judge scores a random returning worker
+//  ->   state:    printPopulationState scan over the cues and neutral gene of every worker
+//  ->   going:    tau leaping scan counting the workers outside their nest
+//  -> Compile from main folder: g++ -std=c++2a -O2 ProjectMaintenance/Benchmarks/BenchWorkerLayout.cpp -I. -o benchworkers
+//  -> Run one layout at a time to count cache misses, e.g. perf stat -e cache-misses ./benchworkers columns
+
+#include "Workers.hpp"
+#include <chrono>
+#include <string>
+
+const size_t num_workers = 10;
+const size_t num_checks = 2000000;
+const size_t num_worker_visits = 50000000;         // Workers visited by all scans of one population
+
+// Nests of workers in layout Store, built from the same random draws for every layout
+template <typename Store>
+std::vector<Store> make_nests(const params& p, const size_t num_nests) {
+    SimulationContext ctx(1);
+    std::vector<Store> nests(num_nests);
+    for (auto& nest : nests) {
+        cue_profile_t NestMean(p.iNumCues);
+        for (int i = 0; i < p.iNumCues; i++) NestMean[i] = exponential(ctx.rn, 1.0);
+        for (size_t w = 0; w < num_workers; ++w) {
+            Individual worker(static_cast<int>(w), p, ctx, NestMean, 0.0);
+            worker.bIsGoing = bernoulli(ctx.rn, 0.5);
+            nest.push_back(worker);
+        }
+    }
+    return nests;
+}
+
+// Returns ns per call of op
+template <typename Op>
+double bench_ns(const size_t num_calls, Op op) {
+    auto start = std::chrono::high_resolution_clock::now();
+    double checksum = 0.0;
+    for (size_t i = 0; i < num_calls; ++i) {
+        checksum += op(i);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    static volatile double sink;
+    sink = checksum;                                // Keeps the loop from being optimised away
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(num_calls);
+}
+
+// Small populations stay in cache, large ones show the cost of the cache misses of each layout
+template <typename Store>
+void bench_layout(const std::string& name, const params& p, const size_t num_nests) {
+    const std::vector<Store> nests = make_nests<Store>(p, num_nests);
+    const size_t num_scans = num_worker_visits / (num_nests * num_workers);
+
+    // Random nest, judge and returning worker per check, drawn up front so only the accesses are timed
+    rng_t rn(2);
+    std::vector<size_t> picks(3 * num_checks);
+    for (size_t i = 0; i < num_checks; ++i) {
+        picks[3 * i] = uni_int(rn, static_cast<size_t>(0), num_nests);
+        picks[3 * i + 1] = uni_int(rn, static_cast<size_t>(0), num_workers);
+        picks[3 * i + 2] = (picks[3 * i + 1] + 1 + uni_int(rn, static_cast<size_t>(0), num_workers - 1)) % num_workers;
+    }
+
+    const double resident = bench_ns(num_checks, [&](const size_t i) {
+        const auto& nest = nests[picks[3 * i]];
+        return gestalt_distance(nest[picks[3 * i + 1]].IndiCues, nest[picks[3 * i + 2]].IndiCues);
+    });
+
+    const double state = bench_ns(num_scans, [&](size_t) {
+        double total = 0.0;
+        for (const auto& nest : nests) {
+            for (const auto& ant : nest) {
+                for (int c = 0; c < p.iNumCues; ++c) total += ant.IndiCues[c];
+                total += ant.NeutralGene;
+            }
+        }
+        return total;
+    });
+
+    const double going = bench_ns(num_scans, [&](size_t) {
+        double total = 0.0;
+        for (const auto& nest : nests) {
+            for (const auto& ant : nest) {
+                total += ant.bIsGoing ? 1.0 : 0.0;
+            }
+        }
+        return total;
+    });
+
+    std::cout << name << "," << num_nests << "," << resident << "," << state / (num_nests * num_workers)
+              << "," << going / (num_nests * num_workers) << std::endl;
+}
+
+// Optional argument "individuals" or "columns" runs a single layout
+int main(int argc, char* argv[]) {
+    params p;
+    p.iNumCues = 10;
+    p.iNumWorkers = num_workers;
+    const std::string only = argc > 1 ? argv[1] : "";
+
+    std::cout << "layout,nests,resident_ns_per_check,state_ns_per_worker,going_ns_per_worker" << std::endl;
+    for (size_t num_nests : {200, 20000}) {
+        if (only.empty() || only == "individuals") bench_layout<std::vector<Individual>>("individuals", p, num_nests);
+        if (only.empty() || only == "columns") bench_layout<WorkerColumns>("columns", p, num_nests);
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+//  -> Checks the Bray Curtis kernels of Distance.hpp against the original per cue loops
+//  -> for random profiles of 1 to 256 cues, including zero and tied cues, and the
+//  -> unrolled fixed width loops of CueProfile for 2, 5, 10, 20 and 50 cues, and
+//  -> CueProfile<10> holding 5 or 12 cues on the dynamic path
+//  -> Add -DCUE_COUNT=7 to run the Individual checks on fixed width profiles
+//  -> Compile from main folder: g++ -std=c++2a -O2 ProjectMaintenance/OldTestingCodes/TestingDistance.cpp -I. -o testingdistance
+#include "Individual.hpp"
+#include <iostream>
+
+// Reference loops, as the distance functions of Individual were written before the kernels
+double reference_distance(const std::vector<double>& a, const std::vector<double>& b, const int mode) {
+    double distance = 0.0;
+    double sum1 = 0.0;
+    double sum2 = 0.0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        distance += std::min(a[i], b[i]);
+        if (mode == 1 && a[i] < b[i]) {             // desirable-present
+            sum1 += a[i];
+            sum2 += a[i];
+        } else if (mode == 2 && b[i] < a[i]) {      // undesirable-absent
+            sum1 += b[i];
+            sum2 += b[i];
+        } else {
+            sum1 += a[i];
+            sum2 += b[i];
+        }
+    }
+    if ((sum1 + sum2) > 0) {
+        return 1.0 - (2.0 * distance / (sum1 + sum2));
+    }
+    throw std::runtime_error("Sum of profile elements is zero");
+}
+
+// Distance of mode computed through a given kernel
+double kernel_distance(ProfileSumsKernel kernel, const std::vector<double>& a, const std::vector<double>& b, const int mode) {
+    const ProfileSums sums = kernel(a.data(), b.data(), a.size());
+    if (mode == 1) return bray_curtis(sums.shared, sums.shared + sums.sum_a);
+    if (mode == 2) return bray_curtis(sums.shared, sums.shared + sums.sum_b);
+    return bray_curtis(sums.shared, sums.sum_a + sums.sum_b);
+}
+
+// Cue value as drawn in Nest, with zeros (mutations clamp at 0) and ties thrown in
+double random_cue(rng_t& rn, const std::vector<double>& other, const size_t i) {
+    const double u = uni_real(rn);
+    if (u < 0.1) return 0.0;
+    if (u < 0.2 && i < other.size()) return other[i];
+    return exponential(rn, 0.1);
+}
+
+// Checks the distance functions on fixed width profiles of K cues holding n cues
+template <size_t K>
+void check_fixed(rng_t& rn, int& failures, double& worst, const double tolerance, const size_t n = K) {
+    for (int trial = 0; trial < 1000; ++trial) {
+        std::vector<double> a, b;
+        for (size_t i = 0; i < n; ++i) a.push_back(random_cue(rn, b, i));
+        for (size_t i = 0; i < n; ++i) b.push_back(random_cue(rn, a, i));
+        const CueProfile<K> fa(a), fb(b);
+        if (fa.size() != n || fa.to_vector() != a) {
+            ++failures;
+            std::cout << "Cues not kept: fixed width " << K << ", " << n << " cues" << std::endl;
+        }
+        for (int mode = 0; mode < 3; ++mode) {
+            double expected = 0.0;
+            try {
+                expected = reference_distance(a, b, mode);
+            } catch (const std::runtime_error&) {
+                continue;
+            }
+            double value = (mode == 0) ? gestalt_distance(fa, fb) : (mode == 1) ? dpresent_distance(fa, fb) : uabsent_distance(fa, fb);
+            const double error = std::abs(value - expected);
+            worst = std::max(worst, error);
+            if (error > tolerance) {
+                ++failures;
+                std::cout << "Mismatch: fixed width " << K << ", mode " << mode << ", " << n << " cues, error " << error << std::endl;
+            }
+        }
+    }
+}
+
+int main() {
+    rng_t rn(2024);
+    std::vector<std::pair<std::string, ProfileSumsKernel>> kernels = {{"scalar", profile_sums_scalar}};
+#ifdef DISTANCE_X86
+    if (__builtin_cpu_supports("sse4.2")) kernels.push_back({"sse4.2", profile_sums_sse42});
+    if (__builtin_cpu_supports("avx2")) kernels.push_back({"avx2", profile_sums_avx2});
+#endif
+    const double tolerance = 1e-12;
+    int failures = 0;
+    double worst = 0.0;
+    for (size_t n = 1; n <= 256; ++n) {
+        for (int trial = 0; trial < 50; ++trial) {
+            std::vector<double> a, b;
+            for (size_t i = 0; i < n; ++i) a.push_back(random_cue(rn, b, i));
+            for (size_t i = 0; i < n; ++i) b.push_back(random_cue(rn, a, i));
+            for (int mode = 0; mode < 3; ++mode) {
+                double expected = 0.0;
+                bool bExpectError = false;
+                try {
+                    expected = reference_distance(a, b, mode);
+                } catch (const std::runtime_error&) {
+                    bExpectError = true;
+                }
+                for (auto& [name, kernel] : kernels) {
+                    // Profiles without any cues counted must throw as before
+                    if (bExpectError) {
+                        try {
+                            kernel_distance(kernel, a, b, mode);
+                            ++failures;
+                            std::cout << "Missing error: kernel " << name << ", mode " << mode << ", " << n << " cues" << std::endl;
+                        } catch (const std::runtime_error&) {}
+                        continue;
+                    }
+                    const double error = std::abs(kernel_distance(kernel, a, b, mode) - expected);
+                    worst = std::max(worst, error);
+                    if (error > tolerance) {
+                        ++failures;
+                        std::cout << "Mismatch: kernel " << name << ", mode " << mode << ", " << n << " cues, error " << error << std::endl;
+                    }
+                }
+            }
+        }
+    }
+
+    check_fixed<2>(rn, failures, worst, tolerance);
+    check_fixed<5>(rn, failures, worst, tolerance);
+    check_fixed<10>(rn, failures, worst, tolerance);
+    check_fixed<20>(rn, failures, worst, tolerance);
+    check_fixed<50>(rn, failures, worst, tolerance);
+    check_fixed<10>(rn, failures, worst, tolerance, 5);
+    check_fixed<10>(rn, failures, worst, tolerance, 12);
+
+    // Individual functions go through the profile type the program is compiled with
+    params p;
+    SimulationContext ctx(1);
+    p.iNumCues = 7;
+    std::vector<double> nestMean = {164, 57, 266, 41, 0, 49, 3};
+    std::vector<double> otherProfile = {3, 169, 9, 131, 6, 0, 3};
+    const cue_profile_t mean(nestMean), other(otherProfile);
+    Individual ind(0, p, ctx, mean, 0.1);
+    const std::vector<double> own = ind.IndiCues.to_vector();
+    const double individual_errors[] = {
+        std::abs(ind.calculateGestaltDist(mean, other) - reference_distance(nestMean, otherProfile, 0)),
+        std::abs(ind.calculateDPresentDist(mean, other) - reference_distance(nestMean, otherProfile, 1)),
+        std::abs(ind.calculateUAbsentDist(mean, other) - reference_distance(nestMean, otherProfile, 2)),
+        std::abs(ind.calculateGestaltDistInd(other) - reference_distance(own, otherProfile, 0)),
+        std::abs(ind.calculateDPresentDistInd(other) - reference_distance(own, otherProfile, 1)),
+        std::abs(ind.calculateUAbsentDistInd(other) - reference_distance(own, otherProfile, 2))};
+    for (double error : individual_errors) {
+        if (error > tolerance) {
+            ++failures;
+            std::cout << "Mismatch in Individual distance functions, error " << error << std::endl;
+        }
+    }
+
+    std::cout << "Kernels tested:";
+    for (auto& kernel : kernels) std::cout << " " << kernel.first;
+    std::cout << std::endl << "Largest difference to reference: " << worst << std::endl;
+    std::cout << (failures == 0 ? "All distance kernels match the reference" : "Distance kernels differ from the reference") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
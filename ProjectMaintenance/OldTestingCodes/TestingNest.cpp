@@ -1,6 +1,10 @@
 #include <iostream>
 #include "Nest.hpp"
 
+// Recognition model and tolerance curve the checks are compiled for, as in the default params
+const int iModel = 0;
+const int iTol = 2;
+
 void printNestInfo(const Nest& nest) {
     std::cout << "Nest ID: " << nest.nest_id << "\n";
     std::cout << "Nest Mean Cues: ";
@@ -16,15 +20,15 @@ void printNestInfo(const Nest& nest) {
 }
 
 // Function to choose a random intruder from a nest and check if it intrudes other nests
-void testIntruder(const Nest& nest, const std::vector<Nest>& allNests, const params& parameters) {
+void testIntruder(const Nest& nest, const std::vector<Nest>& allNests, const params& parameters, SimulationContext& ctx) {
     // Choose a random individual from the nest
-    size_t randomIndex = uni_int(0, nest.NestWorkers.size());
+    size_t randomIndex = uni_int(ctx.rn, static_cast<size_t>(0), nest.NestWorkers.size());
     const Individual& intruder = nest.NestWorkers[randomIndex];
 
     // Check if the intruder can enter other nests
     for (const auto& otherNest : allNests) {
         if (otherNest.nest_id != nest.nest_id) {
-            bool canIntrude = otherNest.check_Intruder(parameters, intruder.IndiCues);
+            bool canIntrude = otherNest.check_Intruder<iModel, iTol>(ctx, intruder.IndiCues);
             std::cout << "Intruder from Nest " << nest.nest_id << " ";
             if (canIntrude)
                 std::cout << "can intrude Nest " << otherNest.nest_id << "\n";
@@ -35,15 +39,15 @@ void testIntruder(const Nest& nest, const std::vector<Nest>& allNests, const par
 }
 
 // Function to choose a random resident from a nest and check if it returns successfully
-void testResident(const Nest& nest, const std::vector<Nest>& allNests, const params& parameters) {
+void testResident(const Nest& nest, const std::vector<Nest>& allNests, const params& parameters, SimulationContext& ctx) {
     // Choose a random individual from the nest
-    size_t randomIndex = uni_int(0, nest.NestWorkers.size());
+    size_t randomIndex = uni_int(ctx.rn, static_cast<size_t>(0), nest.NestWorkers.size());
     const Individual& resident = nest.NestWorkers[randomIndex];
 
     // Check if the resident can return to other nests
     for (const auto& otherNest : allNests) {
         if (otherNest.nest_id == nest.nest_id) {
-            bool canReturn = otherNest.check_Resident(parameters, resident);
+            bool canReturn = otherNest.check_Resident<iModel, iTol>(ctx, resident);
             std::cout << "Resident from Nest " << nest.nest_id << " ";
             if (canReturn)
                 std::cout << "can return to Nest " << otherNest.nest_id << "\n";
@@ -56,14 +60,15 @@ void testResident(const Nest& nest, const std::vector<Nest>& allNests, const par
 int main() {
     // Parameters
     params parameters;
+    SimulationContext ctx(1);
 
     // Create two nests using the default constructor
-    Nest nest1(1, parameters);
-    Nest nest2(2, parameters);
+    Nest nest1(1, parameters, ctx);
+    Nest nest2(2, parameters, ctx);
 
     // Create daughter nests from each of the existing nests
-    Nest daughterNest1(3, parameters, nest1);
-    Nest daughterNest2(4, parameters, nest2);
+    Nest daughterNest1(3, parameters, ctx, nest1);
+    Nest daughterNest2(4, parameters, ctx, nest2);
 
     // Vector to store all nests
     std::vector<Nest> allNests = {nest1, nest2, daughterNest1, daughterNest2};
@@ -99,13 +104,13 @@ int main() {
     // Test intruder check for each nest
     std::cout << "\nTesting intruder check:\n";
     for (const auto& nest : allNests) {
-        testIntruder(nest, allNests, parameters);
+        testIntruder(nest, allNests, parameters, ctx);
     }
 
     // Test resident check for each nest
     std::cout << "\nTesting resident check:\n";
     for (const auto& nest : allNests) {
-        testResident(nest, allNests, parameters);
+        testResident(nest, allNests, parameters, ctx);
     }
 
     return 0;
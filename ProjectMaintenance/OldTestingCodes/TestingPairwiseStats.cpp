@@ -0,0 +1,119 @@
+//  -> Checks the pairwise Bray Curtis statistics of PairwiseStats.hpp
+//  -> exact mode against the original all pairs loop, for 1 and 4 threads
+//  -> PairwiseSums against exact mode over random adds and removes, including all zero profiles
+//  -> Compile from main folder: g++ -std=c++2a -O2 ProjectMaintenance/OldTestingCodes/TestingPairwiseStats.cpp -I. -o testingpairwise -pthread
+#include "PairwiseStats.hpp"
+#include <iostream>
+
+// Cue values as drawn in Nest, a fifth of the profiles has all cues clamped at 0
+std::vector<double> random_profile(rng_t& rn, const size_t num_cues) {
+    std::vector<double> profile(num_cues, 0.0);
+    if (uni_real(rn) < 0.2) return profile;
+    for (auto& cue : profile) cue = uni_real(rn) < 0.1 ? 0.0 : exponential(rn, 0.1);
+    return profile;
+}
+
+// Rows of profiles as a row major matrix
+std::vector<double> flatten(const std::vector<std::vector<double>>& profiles) {
+    std::vector<double> flat;
+    for (const auto& profile : profiles) flat.insert(flat.end(), profile.begin(), profile.end());
+    return flat;
+}
+
+// Mean and std of PairwiseSums compared to exact mode of the same profiles
+void check_running(const PairwiseSums& running, const std::vector<std::vector<double>>& profiles, const size_t num_cues,
+                   const std::string& label, int& failures) {
+    const auto fresh = pairwise_bray_curtis_exact(flatten(profiles), num_cues);
+    const auto kept = running.mean_std();
+    if (running.size() != profiles.size()) {
+        ++failures;
+        std::cout << "Size mismatch: " << label << std::endl;
+    }
+    if (profiles.size() < 2) return;
+    if (!std::isfinite(std::get<0>(kept)) || !std::isfinite(std::get<1>(kept)) ||
+        std::abs(std::get<0>(kept) - std::get<0>(fresh)) > 1e-9 || std::abs(std::get<1>(kept) - std::get<1>(fresh)) > 1e-6) {
+        ++failures;
+        std::cout << "Mismatch: " << label << ", running " << std::get<0>(kept) << " " << std::get<1>(kept)
+                  << ", exact " << std::get<0>(fresh) << " " << std::get<1>(fresh) << std::endl;
+    }
+}
+
+int main() {
+    rng_t rn(2024);
+    const size_t num_cues = 5;
+    int failures = 0;
+
+    // Exact mode against the original loop, on profiles without empty pairs the original cannot score
+    for (size_t n : {2, 3, 63, 64, 65, 300}) {
+        std::vector<std::vector<double>> profiles;
+        for (size_t i = 0; i < n; ++i) {
+            std::vector<double> profile(num_cues);
+            for (auto& cue : profile) cue = exponential(rn, 0.1);
+            profiles.push_back(profile);
+        }
+        const auto reference = calculatePairwiseBrayCurtis(profiles);
+        const auto single = pairwise_bray_curtis_exact(flatten(profiles), num_cues, 1);
+        const auto threaded = pairwise_bray_curtis_exact(flatten(profiles), num_cues, 4);
+        if (std::abs(std::get<0>(single) - std::get<0>(reference)) > 1e-12 || std::abs(std::get<1>(single) - std::get<1>(reference)) > 1e-12) {
+            ++failures;
+            std::cout << "Exact mode differs from the original loop for " << n << " profiles" << std::endl;
+        }
+        if (single != threaded) {
+            ++failures;
+            std::cout << "Exact mode depends on the number of threads for " << n << " profiles" << std::endl;
+        }
+    }
+
+    // Empty profiles are at distance 0 of each other
+    std::vector<std::vector<double>> empty_pair(2, std::vector<double>(num_cues, 0.0));
+    if (std::get<0>(pairwise_bray_curtis_exact(flatten(empty_pair), num_cues)) != 0.0) {
+        ++failures;
+        std::cout << "Two empty profiles are not at distance 0" << std::endl;
+    }
+
+    // Running sums over random births and deaths, slots reused as NestSlots does
+    PairwiseSums running(num_cues);
+    std::vector<size_t> slots;
+    std::vector<std::vector<double>> profiles;
+    std::vector<size_t> free_slots;
+    size_t next_slot = 0;
+    for (int step = 0; step < 3000; ++step) {
+        if (profiles.size() < 2 || (profiles.size() < 60 && uni_real(rn) < 0.55)) {
+            size_t slot = next_slot;
+            if (!free_slots.empty()) {
+                slot = free_slots.back();
+                free_slots.pop_back();
+            } else {
+                ++next_slot;
+            }
+            profiles.push_back(random_profile(rn, num_cues));
+            slots.push_back(slot);
+            running.add(slot, profiles.back());
+        } else {
+            const size_t i = uni_int(rn, static_cast<size_t>(0), profiles.size());
+            running.remove(slots[i]);
+            free_slots.push_back(slots[i]);
+            profiles[i] = profiles.back();
+            profiles.pop_back();
+            slots[i] = slots.back();
+            slots.pop_back();
+        }
+        if (step % 100 == 0) check_running(running, profiles, num_cues, "step " + std::to_string(step), failures);
+    }
+
+    // Adding and then removing an all zero profile, next to another one, leaves the sums finite
+    const std::vector<double> empty(num_cues, 0.0);
+    running.add(next_slot, empty);
+    running.add(next_slot + 1, empty);
+    profiles.push_back(empty);
+    profiles.push_back(empty);
+    check_running(running, profiles, num_cues, "empty profiles added", failures);
+    running.remove(next_slot);
+    running.remove(next_slot + 1);
+    profiles.pop_back();
+    profiles.pop_back();
+    check_running(running, profiles, num_cues, "empty profiles removed", failures);
+
+    std::cout << (failures == 0 ? "Pairwise statistics match exact mode" : "Pairwise statistics differ from exact mode") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -1,6 +1,10 @@
 #include <iostream>
 #include "Population.hpp"
 
+// Choices the population functions are compiled for: gestalt, control tolerance,
+// sorted killing, mass and individual reproduction
+using Policy = SimPolicy<0, 2, 1, 2>;
+
 void printPopulationDetails(const Population& pop) {
     std::cout << "> Storer IDs: ";
     printVector(pop.storer_nest_id);
@@ -24,6 +28,11 @@ int main() {
     par.iNumColonies = 10;  // Number of colonies
     par.dInitFoodStock = 100; // Initial food stock
     par.dInitNestStock = 50; // Initial nest stock
+    // Choices as compiled in Policy
+    par.iModelChoice = 0;
+    par.iTolChoice = 2;
+    par.iKillChoice = 1;
+    par.iRepChoice = 2;
     // You can set other parameters as needed
 
     // Create a population
@@ -37,16 +46,18 @@ int main() {
         pop.nests[i].NestStock = pow(8, i);
     }
 
-    // Call the update_storer function
-    pop.update_storer();
+    // Call the update_storer function for every nest
+    for (size_t i = 0; i < pop.nests.size(); ++i) {
+        pop.update_storer(i);
+    }
 
     // Print storer_stocks and storer_nest_id to confirm
     std::cout << "INITIAL POPULATION: " << std::endl;
     printPopulationDetails(pop);
 
     // 1) Test the kill nest function
-    unsigned int nestToKill = 3; // For example, kill nest with ID 3
-    pop.kill_nest(nestToKill);
+    unsigned int nestToKill = 3; // For example, kill nest at index 3
+    pop.kill_nest<Policy>(nestToKill);
 
     // Print storer_stocks and storer_nest_id to confirm
     std::cout << "\nAFTER KILLING NEST " << nestToKill << ":" << std::endl;
@@ -59,13 +70,13 @@ int main() {
     std::cout << "\nAFTER REPRODUCTION" << std::endl;
     printPopulationDetails(pop);
 
-    gtime = 1001.0;
+    pop.ctx.gtime = 1001.0;
     // Test population regeneration of food
     pop.regenerate_food();
-    pop.nests[0].metabolic_cost(par);
+    pop.nests[0].metabolic_cost(par, pop.ctx);
     
     // 2) Test the mass_kill function
-    pop.mass_kill();
+    pop.mass_kill<Policy>();
     
 
     // Print storer_stocks and storer_nest_id to confirm reproduction
@@ -73,15 +84,15 @@ int main() {
     printPopulationDetails(pop);
 
     // 2) Test the mass_reproduce function
-    pop.mass_reproduce();
+    pop.mass_reproduce<Policy>();
 
     // Print storer_stocks and storer_nest_id to confirm reproduction
     std::cout << "\nAFTER MASS REPRODUCE" << std::endl;
     printPopulationDetails(pop);
 
     // 2) Test the mass_kill function
-    gtime = 2001.0;
-    pop.mass_kill();
+    pop.ctx.gtime = 2001.0;
+    pop.mass_kill<Policy>();
 
     // Print storer_stocks and storer_nest_id to confirm reproduction
     std::cout << "\nAFTER SECOND MASS KILL" << std::endl;
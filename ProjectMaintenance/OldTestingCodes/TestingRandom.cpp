@@ -2,28 +2,31 @@
 #include <iostream>
 
 int main() {
+    // Random number stream the functions draw from
+    rng_t rn(1);
+
     // Test bernoulli distribution
-    std::cout << "Bernoulli distribution: " << bernoulli(0.1) << std::endl;
-    std::cout << "Bernoulli distribution: " << bernoulli(0.1) << std::endl;
-    std::cout << "Bernoulli distribution: " << bernoulli(0.1) << std::endl;
-    std::cout << "Bernoulli distribution: " << bernoulli(0.1) << std::endl;
-    std::cout << "Bernoulli distribution: " << bernoulli(0.1) << std::endl;
-    std::cout << "Bernoulli distribution: " << bernoulli(0.1) << std::endl;
+    std::cout << "Bernoulli distribution: " << bernoulli(rn, 0.1) << std::endl;
+    std::cout << "Bernoulli distribution: " << bernoulli(rn, 0.1) << std::endl;
+    std::cout << "Bernoulli distribution: " << bernoulli(rn, 0.1) << std::endl;
+    std::cout << "Bernoulli distribution: " << bernoulli(rn, 0.1) << std::endl;
+    std::cout << "Bernoulli distribution: " << bernoulli(rn, 0.1) << std::endl;
+    std::cout << "Bernoulli distribution: " << bernoulli(rn, 0.1) << std::endl;
 
     // Test normal distribution
-    std::cout << "Normal distribution: " << normal(0.0, 1.0) << std::endl;
+    std::cout << "Normal distribution: " << normal(rn, 0.0, 1.0) << std::endl;
 
     // Test uniform integer distribution
-    std::cout << "Uniform integer distribution: " << uni_int(1, 10) << std::endl;
+    std::cout << "Uniform integer distribution: " << uni_int(rn, 1, 10) << std::endl;
 
     // Test uniform real distribution
-    std::cout << "Uniform real distribution: " << uni_real(0.0, 1.0) << std::endl;
+    std::cout << "Uniform real distribution: " << uni_real(rn, 0.0, 1.0) << std::endl;
 
     // Test binomial distribution
-    std::cout << "Binomial distribution: " << binom(10, 0.5) << std::endl;
+    std::cout << "Binomial distribution: " << binom(rn, 10, 0.5) << std::endl;
 
     // Test exponential distribution
-    std::cout << "Exponential distribution: " << exponential(1.0) << std::endl;
+    std::cout << "Exponential distribution: " << exponential(rn, 1.0) << std::endl;
 
     // Test logistic function
     std::cout << "Logistic function: " << logistic(0.0) << std::endl;
@@ -36,7 +39,7 @@ int main() {
 
     // Test randomSubset function
     std::vector<int> individuals = {1, 2, 3, 4, 5};
-    std::vector<int> subset = randomSubset(individuals, 2);
+    std::vector<int> subset = randomSubset(rn, individuals, 2);
     std::cout << "Random subset: ";
     printVector(subset);
 
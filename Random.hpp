@@ -18,29 +18,326 @@
 #include <algorithm>
 #include <tuple>
 #include <numeric>
+#include <atomic>
+#include <cstring>
+
+// Philox4x32-10 counter-based generator (Salmon et al. 2011, Random123)
+// Output block i of a stream is a keyed bijection of the counter (i, replicate, stream),
+// so every (master seed, replicate, stream) triple is an independent, reproducible stream
+// that does not depend on which thread runs it or on any other stream
+class Philox4x32 {
+public:
+    using result_type = uint32_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    explicit Philox4x32(const uint64_t master_seed = 0, const uint32_t replicate = 0, const uint32_t stream = 0) {
+        seed(master_seed, replicate, stream);
+    }
+
+    // Restarts at block 0 of the stream keyed by (master_seed, replicate, stream)
+    void seed(const uint64_t master_seed, const uint32_t replicate = 0, const uint32_t stream = 0) {
+        key = {static_cast<uint32_t>(master_seed), static_cast<uint32_t>(master_seed >> 32)};
+        counter = {0, 0, replicate, stream};
+        next = 4;
+    }
+
+    result_type operator()() {
+        if (next == 4) {
+            output = block(counter, key);
+            if (++counter[0] == 0) ++counter[1];    // 64 bit block counter
+            next = 0;
+        }
+        return output[next++];
+    }
+
+    // Skips z outputs in O(1)
+    void discard(unsigned long long z) {
+        while (z > 0 && next < 4) { ++next; --z; }
+        if (z == 0) return;
+        uint64_t blocks = (static_cast<uint64_t>(counter[1]) << 32 | counter[0]) + z / 4;
+        counter[0] = static_cast<uint32_t>(blocks);
+        counter[1] = static_cast<uint32_t>(blocks >> 32);
+        next = 4;
+        for (unsigned long long i = 0; i < z % 4; ++i) (*this)();
+    }
+
+    // The 10 round bijection of one counter block
+    static std::array<uint32_t, 4> block(std::array<uint32_t, 4> ctr, std::array<uint32_t, 2> k) {
+        for (int round = 0; round < 10; ++round) {
+            const uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * ctr[0];
+            const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u) * ctr[2];
+            ctr = {static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ k[0], static_cast<uint32_t>(p1),
+                   static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ k[1], static_cast<uint32_t>(p0)};
+            k[0] += 0x9E3779B9u;
+            k[1] += 0xBB67AE85u;
+        }
+        return ctr;
+    }
+
+private:
+    std::array<uint32_t, 2> key;
+    std::array<uint32_t, 4> counter;    // Block counter (2 words), replicate, stream
+    std::array<uint32_t, 4> output;     // Current output block
+    int next = 4;                       // Next word of output, 4 if used up
+};
+
+// xoshiro256++ (Blackman & Vigna 2019), 32 byte state and about one ns per 64 bit draw
+// Starting state is taken from the Philox stream of (master_seed, replicate, stream),
+// so streams stay keyed and reproducible exactly as with Philox4x32
+class Xoshiro256pp {
+public:
+    using result_type = uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    explicit Xoshiro256pp(const uint64_t master_seed = 0, const uint32_t replicate = 0, const uint32_t stream = 0) {
+        seed(master_seed, replicate, stream);
+    }
+
+    void seed(const uint64_t master_seed, const uint32_t replicate = 0, const uint32_t stream = 0) {
+        Philox4x32 keyed(master_seed, replicate, stream);
+        for (auto& word : s) {
+            word = static_cast<uint64_t>(keyed()) << 32 | keyed();
+        }
+        if ((s[0] | s[1] | s[2] | s[3]) == 0) s[0] = 1;     // All zero state is a fixed point
+    }
+
+    result_type operator()() {
+        const uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    void discard(unsigned long long z) { while (z-- > 0) (*this)(); }
+
+private:
+    std::array<uint64_t, 4> s;
+
+    static uint64_t rotl(const uint64_t x, const int k) { return (x << k) | (x >> (64 - k)); }
+};
+
+// PCG64, XSL RR output on a 128 bit LCG (O'Neill 2014), needs the GCC/Clang __uint128_t
+// State and stream increment are taken from the Philox stream of (master_seed, replicate, stream)
+class Pcg64 {
+public:
+    using result_type = uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    explicit Pcg64(const uint64_t master_seed = 0, const uint32_t replicate = 0, const uint32_t stream = 0) {
+        seed(master_seed, replicate, stream);
+    }
+
+    // Same seeding sequence as pcg_setseq_128_srandom_r
+    void seed(const uint64_t master_seed, const uint32_t replicate = 0, const uint32_t stream = 0) {
+        Philox4x32 keyed(master_seed, replicate, stream);
+        __uint128_t initstate = 0, initseq = 0;
+        for (int i = 0; i < 4; ++i) initstate = initstate << 32 | keyed();
+        for (int i = 0; i < 4; ++i) initseq = initseq << 32 | keyed();
+        state = 0;
+        inc = initseq << 1 | 1;
+        step();
+        state += initstate;
+        step();
+    }
+
+    result_type operator()() {
+        step();
+        const uint64_t xorshifted = static_cast<uint64_t>(state >> 64) ^ static_cast<uint64_t>(state);
+        const int rot = static_cast<int>(state >> 122);
+        return (xorshifted >> rot) | (xorshifted << ((-rot) & 63));
+    }
+
+    void discard(unsigned long long z) { while (z-- > 0) (*this)(); }
+
+private:
+    __uint128_t state;
+    __uint128_t inc;                    // Stream increment, always odd
+
+    void step() {
+        const __uint128_t mult = static_cast<__uint128_t>(0x2360ED051FC65DA4ULL) << 64 | 0x4385DF649FCCF645ULL;
+        state = state * mult + inc;
+    }
+};
+
+// Engine used by simulations, picked at compile time with -DRNG_ENGINE=<n>
+// 0 for Philox4x32-10, 1 for xoshiro256++ (default), 2 for PCG64
+// ProjectMaintenance/Benchmarks/BenchRandom.cpp compares them
+#ifndef RNG_ENGINE
+#define RNG_ENGINE 1
+#endif
+
+#if RNG_ENGINE == 0
+using engine_t = Philox4x32;
+#elif RNG_ENGINE == 1
+using engine_t = Xoshiro256pp;
+#elif RNG_ENGINE == 2
+using engine_t = Pcg64;
+#else
+#error "Wrong choice of RNG_ENGINE"
+#endif
+
+// Kernels turning a block of random 64 bit words into a block of deviates, plain scalar loops
+// Batching draws into pools this way beats one draw per call (BenchRandom, last table)
+
+// Uniform deviates in [0, 1): top 52 bits of each word as the mantissa of a double in [1, 2)
+void fill_uniform(double* out, const uint64_t* bits, const size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t mantissa = (bits[i] >> 12) | 0x3FF0000000000000ULL;
+        double value;
+        std::memcpy(&value, &mantissa, sizeof(value));
+        out[i] = value - 1.0;
+    }
+}
+
+// Exponential deviates of rate 1 by inversion, 1 - u lies in (0, 1]
+void fill_exponential(double* out, const uint64_t* bits, const size_t n) {
+    fill_uniform(out, bits, n);
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = -std::log(1.0 - out[i]);
+    }
+}
+
+// Standard normal deviates by Box-Muller, pairs are (i, i + n / 2) so n must be even
+void fill_normal(double* out, const uint64_t* bits, const size_t n) {
+    const size_t half = n / 2;
+    const double two_pi = 6.283185307179586;
+    const double half_pi = 1.5707963267948966;
+    fill_uniform(out, bits, n);
+    for (size_t i = 0; i < half; ++i) {
+        const double radius = std::sqrt(-2.0 * std::log(1.0 - out[i]));
+        const double angle = two_pi * out[half + i];
+        out[i] = radius * std::cos(angle);
+        out[half + i] = radius * std::cos(angle - half_pi);     // sin, as cos of the shifted angle
+    }
+}
+
+// Random number stream of one simulation: the engine plus pools of uniform, normal and
+// exponential deviates that are filled a block at a time by the kernels above and handed
+// out in order. Poisson and binomial distribution objects are kept between draws and only
+// redo their setup when their parameters change
+// Behaves as the engine itself where a uniform random bit generator is expected (std::shuffle)
+class RandomStream {
+public:
+    using result_type = engine_t::result_type;
+    static constexpr result_type min() { return engine_t::min(); }
+    static constexpr result_type max() { return engine_t::max(); }
+    static constexpr size_t iPoolSize = 128;            // Deviates per block, even for Box-Muller
+
+    explicit RandomStream(const uint64_t master_seed = 0, const uint32_t replicate = 0, const uint32_t stream = 0) :
+        engine(master_seed, replicate, stream)
+    {}
+
+    result_type operator()() { return engine(); }
+
+    double uniform() { return take(uniform_pool, fill_uniform); }           // [0, 1)
+    double std_normal() { return take(normal_pool, fill_normal); }          // Mean 0, sd 1
+    double std_exponential() { return take(exponential_pool, fill_exponential); }  // Rate 1
+
+    engine_t engine;
+    std::poisson_distribution<int> poisson_dist;
+    std::binomial_distribution<int> binom_dist;
+
+private:
+    struct DeviatePool {
+        std::array<double, iPoolSize> values;
+        size_t next = iPoolSize;                        // Next deviate handed out, iPoolSize if used up
+    };
+
+    DeviatePool uniform_pool;
+    DeviatePool normal_pool;
+    DeviatePool exponential_pool;
+    std::array<uint64_t, iPoolSize> bits;               // Raw words of the block being filled
+
+    // 64 bit word of the engine, 32 bit engines give two outputs
+    uint64_t word() {
+        if constexpr (sizeof(result_type) >= 8) {
+            return engine();
+        } else {
+            const uint64_t high = engine();
+            return high << 32 | engine();
+        }
+    }
+
+    template <typename Kernel>
+    double take(DeviatePool& pool, Kernel kernel) {
+        if (pool.next == iPoolSize) {
+            for (auto& b : bits) b = word();
+            kernel(pool.values.data(), bits.data(), iPoolSize);
+            pool.next = 0;
+        }
+        return pool.values[pool.next++];
+    }
+};
+
+// Random number stream, every simulation owns one (see SimulationContext)
+// All functions below draw from the stream they are given
+using rng_t = RandomStream;
+
+// Streams of one replicate, simulation dynamics draw from stream 0
+// and sampled output statistics from stream 1, so they never change the dynamics
+const uint32_t iStreamSimulation = 0;
+const uint32_t iStreamStatistics = 1;
+const uint32_t iStreamSimulationID = 0xFFFFFFFF;
+
+// Samples a master seed from the clock for runs started without one
+// Counter keeps seeds of runs started at the same moment in one process apart
+uint64_t make_master_seed() {
+    static std::atomic<uint64_t> started{0};
+    return static_cast<uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count()) + started++;
+}
 
-unsigned int simulationID = static_cast<unsigned int>(std::chrono::high_resolution_clock::now().time_since_epoch().count()); // sample a seed
-std::mt19937 rn(simulationID); // seed the random number generator
+// Simulation ID of a replicate, first word of its reserved ID stream
+// Same master seed and replicate always give the same ID (and output file names)
+unsigned int make_simulationID(const uint64_t master_seed, const uint32_t replicate) {
+    return Philox4x32(master_seed, replicate, iStreamSimulationID)();
+}
 
 // bernoulli distribution (default p=0.5)
-bool bernoulli(double p=0.5) { return std::bernoulli_distribution(p)(rn); }
+bool bernoulli(rng_t& rn, double p=0.5) { return rn.uniform() < p; }
 
 // normal distribution
-double normal(double mean, double sd) { return std::normal_distribution<double>(mean, sd)(rn); }
+double normal(rng_t& rn, double mean, double sd) { return mean + sd * rn.std_normal(); }
 
 // uniform integer distribution
 template<typename T1, typename T2>
-T2 uni_int(T1 lower, T2 upper) { return std::uniform_int_distribution<T2>(lower, upper - 1)(rn); }
+T2 uni_int(rng_t& rn, T1 lower, T2 upper) { return std::uniform_int_distribution<T2>(lower, upper - 1)(rn.engine); }
 
 // uniform real distribution (default limits 0-1)
-double uni_real(double lower = 0.0, double upper = 1.0) { return std::uniform_real_distribution<double>(lower, upper)(rn); }
+double uni_real(rng_t& rn, double lower = 0.0, double upper = 1.0) { return lower + (upper - lower) * rn.uniform(); }
+
+// binomial distribution, few trials are counted one by one as that beats setting up
+// binomial_distribution, otherwise setup is redone only when n or p change
+int binom(rng_t& rn, int n, double p) {
+    if (n < 16) {
+        int k = 0;
+        for (int i = 0; i < n; ++i) k += (rn.uniform() < p);
+        return k;
+    }
+    if (rn.binom_dist.t() != n || rn.binom_dist.p() != p) {
+        rn.binom_dist = std::binomial_distribution<int>(n, p);
+    }
+    return rn.binom_dist(rn.engine);
+}
 
-// binomial distribution
-int binom(int n, double p) { return std::binomial_distribution<int>(n,p)(rn); }
+// poisson distribution, setup is redone only when the mean changes
+int poisson(rng_t& rn, double mean) {
+    if (rn.poisson_dist.mean() != mean) {
+        rn.poisson_dist = std::poisson_distribution<int>(mean);
+    }
+    return rn.poisson_dist(rn.engine);
+}
 
 // exponential distribution
-double exponential(double lambda) {
-    return std::exponential_distribution<double>(lambda)(rn);
+double exponential(rng_t& rn, double lambda) {
+    return rn.std_exponential() / lambda;
 }
 
 // logistic function
@@ -59,18 +356,18 @@ void remove_from_vec(std::vector<T>& v, const size_t idx) {
 
 // Function to randomly select alpha number of individuals
 template <typename T>
-std::vector<T> randomSubset(const std::vector<T>& individuals, int alpha) {
+std::vector<T> randomSubset(rng_t& rn, const std::vector<T>& individuals, int alpha) {
     // Copy the vector to avoid modifying the original vector
     std::vector<T> result = individuals;
 
     if (alpha >= individuals.size()) {
         // Shuffle the entire vector if alpha is greater or equal to the vector size
-        std::shuffle(result.begin(), result.end(), rn);
+        std::shuffle(result.begin(), result.end(), rn.engine);
         return result;
     }
 
     // Shuffle the vector to randomize the selection
-    std::shuffle(result.begin(), result.end(), rn);
+    std::shuffle(result.begin(), result.end(), rn.engine);
 
     // Resize the vector to contain only alpha elements
     result.resize(alpha);
@@ -78,35 +375,220 @@ std::vector<T> randomSubset(const std::vector<T>& individuals, int alpha) {
     return result;
 }
 
-int chooseProbableIndex(const std::vector<double>& probabilities) {
+// Samples index in [0, n) other than excluded uniformly, O(1) and without allocation
+// Draws from the n-1 allowed indices and shifts those at or above excluded by one
+size_t uni_int_excluding(rng_t& rn, const size_t n, const size_t excluded) {
+    size_t k = uni_int(rn, static_cast<size_t>(0), n - 1);
+    return (k >= excluded) ? k + 1 : k;
+}
+
+// Multinomial split of n draws over k equally likely categories, calls add(category, count)
+// once for every category drawn at least once. Few draws (n < k) are drawn one by one and
+// grouped in scratch, more are split category by category as conditional binomials,
+// so the cost is O(min(n, k)) draws
+template <typename AddFn>
+void split_uniform(rng_t& rn, int n, const size_t k, std::vector<size_t>& scratch, AddFn add) {
+    if (n <= 0 || k == 0) return;
+    if (static_cast<size_t>(n) < k) {
+        scratch.clear();
+        for (int i = 0; i < n; ++i) scratch.push_back(uni_int(rn, static_cast<size_t>(0), k));
+        std::sort(scratch.begin(), scratch.end());
+        for (size_t i = 0; i < scratch.size(); ) {
+            size_t j = i;
+            while (j < scratch.size() && scratch[j] == scratch[i]) ++j;
+            add(scratch[i], static_cast<int>(j - i));
+            i = j;
+        }
+    } else {
+        for (size_t c = 0; c < k && n > 0; ++c) {
+            const int m = (c + 1 == k) ? n : binom(rn, n, 1.0 / static_cast<double>(k - c));
+            if (m > 0) add(c, m);
+            n -= m;
+        }
+    }
+}
+
+// Weighted version of uni_int_excluding by rejection against an upper bound of the weights
+// weight(i) must lie in [0, max_weight], needs O(max_weight / mean weight) draws on average
+// Lets per-index weights (distance, stock...) be plugged in without building any arrays
+template <typename WeightFn>
+size_t sample_excluding(rng_t& rn, const size_t n, const size_t excluded, WeightFn weight, const double max_weight) {
+    if (max_weight <= 0.0) {
+        throw std::invalid_argument("The maximum weight must be positive.");
+    }
+    while (true) {
+        size_t k = uni_int_excluding(rn, n, excluded);
+        if (uni_real(rn, 0.0, max_weight) < weight(k)) return k;
+    }
+}
+
+// Policy for negative weights in all weighted samplers below (e.g. negative nest stocks):
+// they are treated as zero, so such indices are never chosen
+// If no weight is positive the samplers throw std::invalid_argument
+double sampling_weight(const double w) { return (w > 0.0) ? w : 0.0; }
+
+int chooseProbableIndex(rng_t& rn, const std::vector<double>& probabilities) {
     if (probabilities.empty()) {
         throw std::invalid_argument("The input vector must not be empty.");
     }
 
-    // Calculate the total sum of the probabilities
-    double total = std::accumulate(probabilities.begin(), probabilities.end(), 0.0);
+    // Create a cumulative distribution, negative weights count as zero
+    std::vector<double> cumulative(probabilities.size());
+    double total = 0.0;
+    for (size_t i = 0; i < probabilities.size(); ++i) {
+        total += sampling_weight(probabilities[i]);
+        cumulative[i] = total;
+    }
 
     if (total <= 0) {
         throw std::invalid_argument("The sum of probabilities must be positive.");
     }
 
-    // Create a cumulative distribution
-    std::vector<double> cumulative(probabilities.size());
-    std::partial_sum(probabilities.begin(), probabilities.end(), cumulative.begin());
-
     // Normalize the cumulative distribution
     for (double& value : cumulative) {
         value /= total;
     }
 
     // Generate a random number between 0 and 1
-    double randomValue = uni_real();
+    double randomValue = uni_real(rn);
 
     // Find the index corresponding to the random value
     auto it = std::lower_bound(cumulative.begin(), cumulative.end(), randomValue);
     return std::distance(cumulative.begin(), it);
 }
 
+// Fenwick (binary indexed) tree over weights for repeated weighted sampling
+// Weight updates and draws cost O(log n), used when weights change between draws
+// Tree is rebuilt from the raw weights every few n updates to flush rounding drift
+class FenwickSampler {
+public:
+    FenwickSampler(const size_t n = 0) { resize(n); }
+
+    size_t size() const { return weights.size(); }
+    double total() const { return sum; }
+    double weight(const size_t i) const { return weights[i]; }
+
+    // Resizes keeping existing weights, new indices get weight 0
+    void resize(const size_t n) {
+        weights.resize(n, 0.0);
+        rebuild();
+    }
+
+    // Replaces all weights at once in O(n), negative weights are stored as zero
+    void assign(const std::vector<double>& w) {
+        weights.resize(w.size());
+        std::transform(w.begin(), w.end(), weights.begin(), sampling_weight);
+        rebuild();
+    }
+
+    // Sets weight of index i, negative weights are stored as zero
+    void set(const size_t i, const double w) {
+        const double wi = sampling_weight(w);
+        const double delta = wi - weights[i];
+        if (delta == 0.0) return;
+        weights[i] = wi;
+        for (size_t j = i + 1; j < tree.size(); j += j & (~j + 1)) {
+            tree[j] += delta;
+        }
+        sum += delta;
+        if (++updates > 64 * tree.size()) rebuild();
+    }
+
+    // Draws index with probability proportional to its weight
+    size_t sample(rng_t& rn) const {
+        if (sum <= 0.0) {
+            throw std::invalid_argument("The sum of probabilities must be positive.");
+        }
+        while (true) {
+            double u = uni_real(rn, 0.0, sum);
+            size_t pos = 0;
+            for (size_t step = top_bit; step > 0; step >>= 1) {
+                if (pos + step < tree.size() && tree[pos + step] <= u) {
+                    pos += step;
+                    u -= tree[pos];
+                }
+            }
+            // Rounding can land on a zero weight or past the end, draw again then
+            if (pos < weights.size() && weights[pos] > 0.0) return pos;
+        }
+    }
+
+    // Rebuilds tree from the raw weights in O(n)
+    void rebuild() {
+        tree.assign(weights.size() + 1, 0.0);
+        sum = 0.0;
+        for (size_t i = 0; i < weights.size(); ++i) {
+            tree[i + 1] += weights[i];
+            sum += weights[i];
+            size_t parent = (i + 1) + ((i + 1) & (~(i + 1) + 1));
+            if (parent < tree.size()) tree[parent] += tree[i + 1];
+        }
+        top_bit = 1;
+        while (top_bit * 2 < tree.size()) top_bit *= 2;
+        updates = 0;
+    }
+
+private:
+    std::vector<double> weights;    // Raw weights
+    std::vector<double> tree;       // 1-based Fenwick tree of partial sums
+    double sum = 0.0;               // Total weight
+    size_t top_bit = 1;             // Largest power of two below tree size
+    size_t updates = 0;             // Updates since last rebuild
+};
+
+// Walker/Vose alias table for weighted sampling from fixed weights
+// Built in O(n) once, each draw then costs O(1)
+// Storage is kept between builds, so rebuilding every round does not allocate
+class AliasTable {
+public:
+    void build(const std::vector<double>& weights) {
+        const size_t n = weights.size();
+        prob.resize(n);
+        alias.resize(n);
+        small.clear();
+        large.clear();
+        double total = 0.0;
+        for (double w : weights) total += sampling_weight(w);
+        if (n == 0 || total <= 0.0) {
+            throw std::invalid_argument("The sum of probabilities must be positive.");
+        }
+        // Scale weights so that the average is 1
+        for (size_t i = 0; i < n; ++i) {
+            prob[i] = sampling_weight(weights[i]) * static_cast<double>(n) / total;
+            alias[i] = i;
+            if (prob[i] < 1.0) small.push_back(i);
+            else large.push_back(i);
+        }
+        // Pair each light index with a heavy one that fills up its column
+        while (!small.empty() && !large.empty()) {
+            size_t l = small.back();
+            small.pop_back();
+            size_t g = large.back();
+            alias[l] = g;
+            prob[g] = (prob[g] + prob[l]) - 1.0;
+            if (prob[g] < 1.0) {
+                large.pop_back();
+                small.push_back(g);
+            }
+        }
+        // Leftovers are full columns up to rounding
+        for (size_t i : large) prob[i] = 1.0;
+        for (size_t i : small) prob[i] = 1.0;
+    }
+
+    // Draws index with probability proportional to its weight
+    size_t sample(rng_t& rn) const {
+        size_t i = uni_int(rn, static_cast<size_t>(0), prob.size());
+        return (uni_real(rn) < prob[i]) ? i : alias[i];
+    }
+
+private:
+    std::vector<double> prob;       // Probability of keeping the column index
+    std::vector<size_t> alias;      // Alternative index of each column
+    std::vector<size_t> small;      // Work lists used while building
+    std::vector<size_t> large;
+};
+
 // Function template to calculate the average of a vector of any numeric type
 template <typename T>
 T calculateAverage(const std::vector<T>& values) {
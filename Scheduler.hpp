@@ -0,0 +1,354 @@
+//
+//  Scheduler.hpp
+//  Croziers Paradox
+//
+//  Created by Lakshya Chauhan on 18/04/2024.
+//  Copyright © 2024 Lakshya Chauhan. All rights reserved.
+//  -> Defines worker events and the event schedulers of the simulation loop
+//  -> Scheduler implementation is picked through iSchedulerChoice
+//  -> ProjectMaintenance/Benchmarks/BenchScheduler.cpp compares them
+//  Pt 4.5
+
+#ifndef Scheduler_hpp
+#define Scheduler_hpp
+
+#include "Nest.hpp"
+#include <queue>
+#include <memory>
+#include <limits>
+
+// track_time struct for event queue ordered by next task time
+// Carries the slot handle of the nest, so nest lookup is O(1) and
+// events of dead nests are detected by a generation mismatch
+struct track_time {
+    double time;
+    NestHandle nest;
+    int ind_id;             // Individual ID, equal to its index in NestWorkers
+
+    // event constructor using initializer lists
+    // Worker is an Individual or a WorkerView, see Workers.hpp
+    template <typename Worker>
+    track_time(const Worker& input, const NestHandle& handle) :
+        time{input.t_next},
+        nest{handle},
+        ind_id{input.ind_id}
+    {}
+
+    // event constructor from raw values
+    track_time(const double t, const NestHandle& handle, const int id) :
+        time{t},
+        nest{handle},
+        ind_id{id}
+    {}
+};
+
+// Lambda function for maintaining priority queue
+auto cmptime = [](const track_time& a, const track_time& b) { return a.time > b.time; };
+
+// Housekeeping events of the population, listed in the order they fire at equal times
+enum class SystemEvent { mass_kill, mass_reproduce, reset_counters, output_state, output_deadnests, food_tick };
+
+// system_time struct for housekeeping events on the same time axis as worker events
+struct system_time {
+    double time;
+    SystemEvent type;
+};
+
+// Lambda function for maintaining priority queue of system events
+auto cmpsystem = [](const system_time& a, const system_time& b) {
+    return (a.time != b.time) ? a.time > b.time : a.type > b.type;
+};
+
+// Interface of event schedulers used by Population::simulate
+// pop always returns the earliest pending event
+class EventScheduler {
+public:
+    virtual ~EventScheduler() = default;
+    virtual void push(const track_time& event) = 0;             // Adds a single event
+    virtual track_time pop() = 0;                               // Removes and returns earliest event
+    virtual double next_time() = 0;                             // Time of earliest event, queue not empty
+    virtual bool empty() const = 0;                             // True if no events are pending
+    virtual void cancel_nest(const NestHandle& handle) = 0;     // Drops pending events of a dead nest
+
+    // Adds events of all workers of a nest, schedulers may do this in bulk
+    virtual void push_nest(const Nest& nest) {
+        for (const auto& ind : nest.NestWorkers) {
+            push(track_time(ind, nest.handle));
+        }
+    }
+};
+
+// Single binary heap over all worker events (original scheduler)
+// Events of dead nests are not removed, the loop skips them on generation mismatch
+class HeapScheduler : public EventScheduler {
+public:
+    HeapScheduler() : queue(cmptime) {};
+
+    void push(const track_time& event) override { queue.push(event); }
+    track_time pop() override {
+        track_time next_event = queue.top();
+        queue.pop();
+        return next_event;
+    }
+    double next_time() override { return queue.top().time; }
+    bool empty() const override { return queue.empty(); }
+    void cancel_nest(const NestHandle& /*handle*/) override {}
+
+private:
+    std::priority_queue<track_time, std::vector<track_time>, decltype(cmptime)> queue;
+};
+
+// Two level scheduler: a small min-heap of worker events per nest slot
+// and an indexed top-level heap of slots keyed by each nest's earliest event
+// Killing a nest removes all its events at once in O(log N)
+class NestScheduler : public EventScheduler {
+public:
+    void push(const track_time& event) override {
+        const unsigned int slot = event.nest.slot;
+        ensure_slot(slot);
+        auto& queue = nest_queues[slot];
+        queue.push_back(event);
+        std::push_heap(queue.begin(), queue.end(), cmptime);
+        if (heap_pos[slot] < 0) {
+            heap_insert(slot);
+        } else if (queue.front().time == event.time) {
+            sift_up(heap_pos[slot]);            // Nest key decreased
+        }
+    }
+
+    track_time pop() override {
+        const unsigned int slot = top_heap.front();
+        auto& queue = nest_queues[slot];
+        std::pop_heap(queue.begin(), queue.end(), cmptime);
+        track_time next_event = queue.back();
+        queue.pop_back();
+        if (queue.empty()) {
+            heap_remove(0);
+        } else {
+            sift_down(0);                       // Nest key increased
+        }
+        return next_event;
+    }
+
+    double next_time() override { return key(0); }
+    bool empty() const override { return top_heap.empty(); }
+
+    void cancel_nest(const NestHandle& handle) override {
+        if (handle.slot >= nest_queues.size()) return;
+        if (heap_pos[handle.slot] >= 0) {
+            heap_remove(heap_pos[handle.slot]);
+        }
+        nest_queues[handle.slot].clear();       // Keeps capacity for the next nest in this slot
+    }
+
+    // Builds the nest queue with one make_heap and enters it in the top heap once
+    void push_nest(const Nest& nest) override {
+        const unsigned int slot = nest.handle.slot;
+        ensure_slot(slot);
+        auto& queue = nest_queues[slot];
+        for (const auto& ind : nest.NestWorkers) {
+            queue.push_back(track_time(ind, nest.handle));
+        }
+        std::make_heap(queue.begin(), queue.end(), cmptime);
+        if (queue.empty()) return;
+        if (heap_pos[slot] < 0) {
+            heap_insert(slot);
+        } else {
+            sift_up(heap_pos[slot]);
+        }
+    }
+
+private:
+    std::vector<std::vector<track_time>> nest_queues;  // Min-heap of events per slot
+    std::vector<unsigned int> top_heap;                 // Slots ordered by earliest event
+    std::vector<int> heap_pos;                          // Position of slot in top_heap, -1 if absent
+
+    double key(const size_t pos) const { return nest_queues[top_heap[pos]].front().time; }
+
+    void ensure_slot(const unsigned int slot) {
+        if (slot >= nest_queues.size()) {
+            nest_queues.resize(slot + 1);
+            heap_pos.resize(slot + 1, -1);
+        }
+    }
+
+    void place(const size_t pos, const unsigned int slot) {
+        top_heap[pos] = slot;
+        heap_pos[slot] = static_cast<int>(pos);
+    }
+
+    void heap_insert(const unsigned int slot) {
+        top_heap.push_back(slot);
+        heap_pos[slot] = static_cast<int>(top_heap.size() - 1);
+        sift_up(top_heap.size() - 1);
+    }
+
+    void heap_remove(const size_t pos) {
+        const unsigned int slot = top_heap[pos];
+        const unsigned int last = top_heap.back();
+        top_heap.pop_back();
+        heap_pos[slot] = -1;
+        if (pos < top_heap.size()) {
+            place(pos, last);
+            sift_up(pos);
+            sift_down(heap_pos[last]);
+        }
+    }
+
+    void sift_up(size_t pos) {
+        const unsigned int slot = top_heap[pos];
+        const double t = key(pos);
+        while (pos > 0) {
+            size_t parent = (pos - 1) / 2;
+            if (key(parent) <= t) break;
+            place(pos, top_heap[parent]);
+            pos = parent;
+        }
+        place(pos, slot);
+    }
+
+    void sift_down(size_t pos) {
+        const unsigned int slot = top_heap[pos];
+        const double t = key(pos);
+        const size_t n = top_heap.size();
+        while (true) {
+            size_t child = 2 * pos + 1;
+            if (child >= n) break;
+            if (child + 1 < n && key(child + 1) < key(child)) ++child;
+            if (key(child) >= t) break;
+            place(pos, top_heap[child]);
+            pos = child;
+        }
+        place(pos, slot);
+    }
+};
+
+// Calendar queue (Brown 1988): events are hashed into buckets of fixed time width,
+// one "year" spans all buckets. Each bucket is kept sorted with the earliest event at
+// the back. Number of buckets doubles/halves with the number of events and the width is
+// re-estimated from the spacing of the earliest events, giving amortised O(1) push and pop
+// Like the heap, events of dead nests are skipped by the generation check in the loop
+class CalendarScheduler : public EventScheduler {
+public:
+    CalendarScheduler() { buckets.resize(num_buckets); }
+
+    void push(const track_time& event) override {
+        insert(event);
+        ++num_events;
+        if (num_events > 2 * num_buckets) resize(2 * num_buckets);
+    }
+
+    track_time pop() override { return take(next_bucket()); }
+    double next_time() override { return next_bucket().back().time; }
+    bool empty() const override { return num_events == 0; }
+    void cancel_nest(const NestHandle& /*handle*/) override {}
+
+private:
+    std::vector<std::vector<track_time>> buckets;   // Buckets sorted latest first
+    size_t num_buckets = 2;                         // Number of buckets in a year
+    size_t num_events = 0;                          // Number of pending events
+    double width = 1.0;                             // Time width of a bucket
+    long long current = 0;                          // Virtual bucket (time / width) being served
+
+    long long virtual_bucket(const double t) const { return static_cast<long long>(t / width); }
+
+    // Advances current to the bucket holding the earliest event and returns that bucket
+    std::vector<track_time>& next_bucket() {
+        // Scan one year of buckets starting from the current one
+        for (size_t n = 0; n < num_buckets; ++n) {
+            auto& bucket = buckets[current % num_buckets];
+            if (!bucket.empty() && virtual_bucket(bucket.back().time) <= current) {
+                return bucket;
+            }
+            ++current;
+        }
+        // Nothing due within a year, jump straight to the earliest event
+        size_t earliest = 0;
+        double tmin = std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < num_buckets; ++i) {
+            if (!buckets[i].empty() && buckets[i].back().time < tmin) {
+                tmin = buckets[i].back().time;
+                earliest = i;
+            }
+        }
+        current = virtual_bucket(tmin);
+        return buckets[earliest];
+    }
+
+    void insert(const track_time& event) {
+        // Events before the bucket being served (e.g. pushed after a peek) move it back
+        current = std::min(current, virtual_bucket(event.time));
+        auto& bucket = buckets[virtual_bucket(event.time) % num_buckets];
+        auto it = std::upper_bound(bucket.begin(), bucket.end(), event, cmptime);
+        bucket.insert(it, event);
+    }
+
+    track_time take(std::vector<track_time>& bucket) {
+        track_time next_event = bucket.back();
+        bucket.pop_back();
+        --num_events;
+        if (num_buckets > 2 && num_events < num_buckets / 2) resize(num_buckets / 2);
+        return next_event;
+    }
+
+    // Rebuilds calendar with new number of buckets and a freshly estimated width
+    void resize(const size_t new_num_buckets) {
+        std::vector<track_time> events;
+        events.reserve(num_events);
+        for (auto& bucket : buckets) {
+            events.insert(events.end(), bucket.begin(), bucket.end());
+            bucket.clear();
+        }
+        width = estimate_width(events);
+        num_buckets = new_num_buckets;
+        buckets.resize(num_buckets);
+        double tmin = std::numeric_limits<double>::infinity();
+        for (auto& event : events) {
+            insert(event);
+            tmin = std::min(tmin, event.time);
+        }
+        if (!events.empty()) current = virtual_bucket(tmin);
+    }
+
+    // Width is three times the mean spacing of the earliest events,
+    // ignoring spacings larger than twice the mean as in Brown's original
+    // Buckets then hold a few events each, so the sorted insert is O(1) on average, it
+    // costs O(bucket size) when many events share a time span narrower than the width
+    double estimate_width(std::vector<track_time>& events) const {
+        const size_t nsample = std::min<size_t>(events.size(), 25);
+        if (nsample < 2) return width;
+        auto earlier = [](const track_time& a, const track_time& b) { return a.time < b.time; };
+        std::nth_element(events.begin(), events.begin() + (nsample - 1), events.end(), earlier);
+        std::sort(events.begin(), events.begin() + nsample, earlier);
+        double avg = (events[nsample - 1].time - events[0].time) / static_cast<double>(nsample - 1);
+        double sum = 0.0;
+        int count = 0;
+        for (size_t i = 1; i < nsample; ++i) {
+            double gap = events[i].time - events[i - 1].time;
+            if (gap <= 2.0 * avg) {
+                sum += gap;
+                ++count;
+            }
+        }
+        if (count == 0 || sum <= 0.0) return width;
+        return 3.0 * sum / static_cast<double>(count);
+    }
+};
+
+// Creates the scheduler picked through iSchedulerChoice
+// 0 for single binary heap, 1 for two level per-nest scheduler, 2 for calendar queue
+std::unique_ptr<EventScheduler> make_scheduler(const params& p) {
+    switch (static_cast<int>(p.iSchedulerChoice))
+    {
+    case 0:
+        return std::make_unique<HeapScheduler>();
+    case 1:
+        return std::make_unique<NestScheduler>();
+    case 2:
+        return std::make_unique<CalendarScheduler>();
+    default:
+        throw std::runtime_error("Wrong choice of iSchedulerChoice");
+    }
+}
+
+#endif /* Scheduler_hpp */
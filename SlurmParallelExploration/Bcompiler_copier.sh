@@ -16,7 +16,7 @@ module load compiler/GCC/11.2.0
 Rscript Rcreate_sim_explorer.R
 
 # Compile the program
-g++ -std=c++2a -O2 Random.hpp main.cpp Parameters.hpp Individual.hpp Population.hpp config_parser.h -o myprog -lstdc++fs
+g++ -std=c++2a -O2 -pthread Random.hpp main.cpp Parameters.hpp Individual.hpp Population.hpp config_parser.h -o myprog -lstdc++fs
 
 # Check if compilation was successful
 if [ $? -ne 0 ]; then
@@ -0,0 +1,144 @@
+//
+//  ThreadPool.hpp
+//  Croziers Paradox
+//
+//  Copyright © 2024 Lakshya Chauhan. All rights reserved.
+//  -> Defines a work-stealing thread pool used to run replicate simulations
+//  -> Every thread owns a task queue, idle threads steal from the others
+//  Pt 6
+
+#ifndef ThreadPool_hpp
+#define ThreadPool_hpp
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <exception>
+
+class ThreadPool {
+public:
+    // Starts num_threads worker threads, at least one
+    explicit ThreadPool(size_t num_threads) {
+        if (num_threads == 0) num_threads = 1;
+        for (size_t i = 0; i < num_threads; ++i) {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        for (size_t i = 0; i < num_threads; ++i) {
+            threads.emplace_back(&ThreadPool::worker, this, i);
+        }
+    }
+
+    // Finishes all submitted tasks, then stops and joins the threads
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            bStop = true;
+        }
+        wake.notify_all();
+        for (auto& thread : threads) thread.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Adds task to the queues round robin, any idle thread may steal it
+    void submit(std::function<void()> task) {
+        const size_t target = next_queue++ % queues.size();
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            ++pending;
+            ++queued;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queues[target]->mutex);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+    // Blocks until every submitted task is done
+    // Rethrows the first exception thrown by a task, if any
+    void wait() {
+        std::unique_lock<std::mutex> lock(state_mutex);
+        all_done.wait(lock, [this] { return pending == 0; });
+        if (first_error) {
+            std::exception_ptr error = first_error;
+            first_error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    size_t size() const { return threads.size(); }
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;     // One task queue per thread
+    std::vector<std::thread> threads;
+    std::atomic<size_t> next_queue{0};                  // Round robin counter of submit
+    std::mutex state_mutex;                             // Guards the counters, bStop and first_error
+    std::condition_variable wake;                       // Signals new tasks or stop to idle threads
+    std::condition_variable all_done;                   // Signals pending reaching zero
+    size_t pending = 0;                                 // Tasks submitted but not finished
+    size_t queued = 0;                                  // Tasks submitted but not yet taken by a thread
+    bool bStop = false;
+    std::exception_ptr first_error;
+
+    // Takes newest task of own queue, else steals oldest task of another queue
+    bool try_pop(const size_t self, std::function<void()>& task) {
+        {
+            std::lock_guard<std::mutex> lock(queues[self]->mutex);
+            if (!queues[self]->tasks.empty()) {
+                task = std::move(queues[self]->tasks.back());
+                queues[self]->tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); ++i) {
+            auto& victim = *queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker(const size_t self) {
+        while (true) {
+            std::function<void()> task;
+            if (try_pop(self, task)) {
+                {
+                    std::lock_guard<std::mutex> lock(state_mutex);
+                    --queued;
+                }
+                try {
+                    task();
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(state_mutex);
+                    if (!first_error) first_error = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(state_mutex);
+                if (--pending == 0) all_done.notify_all();
+                continue;
+            }
+            // Nothing to run or steal, sleep until a task is submitted or the pool stops
+            // queued is raised before a task enters a queue, so a wake up is never missed
+            std::unique_lock<std::mutex> lock(state_mutex);
+            if (bStop && queued == 0) return;
+            wake.wait(lock, [this] { return bStop || queued > 0; });
+        }
+    }
+};
+
+#endif /* ThreadPool_hpp */
@@ -0,0 +1,157 @@
+//
+//  Workers.hpp
+//  Croziers Paradox
+//
+//  Copyright © 2024 Lakshya Chauhan. All rights reserved.
+//  -> Defines the worker storage of a nest
+//  -> Default keeps a vector of Individual, -DWORKER_LAYOUT=1 keeps the workers as structure of arrays
+//  -> ProjectMaintenance/Benchmarks/BenchWorkerLayout.cpp compares the two layouts
+//  Pt 3.5
+
+#ifndef Workers_hpp
+#define Workers_hpp
+
+#include "Individual.hpp"
+#include <vector>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <algorithm>
+
+// Lightweight handle on one worker of WorkerColumns, IsConst for read only access
+// Members carry the names of the Individual fields, so simulation code works on both layouts
+// Flags are char as std::vector<bool> gives no references
+template <bool IsConst>
+struct WorkerView {
+    template <typename T>
+    using field_t = std::conditional_t<IsConst, const T&, T&>;
+    using cue_t = std::conditional_t<IsConst, const double, double>;
+
+    CueRowView<cue_t> IndiCues;
+    field_t<double> NeutralGene;
+    field_t<char> bIsGoing;
+    field_t<char> bForage;
+    field_t<char> bSuccesfulFood;
+    field_t<double> t_birth;
+    field_t<double> t_next;
+    field_t<int> ind_id;
+    field_t<unsigned int> nest_id;
+};
+
+// Workers of a nest as structure of arrays: cues in one row major [workers x cues] matrix,
+// every other field in its own column. Scans over one field (cues of all workers in the
+// output statistics, flags in tau leaping) then read only the bytes they use, and the
+// judge and judged cues of the recognition checks come from one contiguous block
+// Workers are only ever appended, the same as with std::vector<Individual>
+class WorkerColumns {
+public:
+    // Index based iterator handing out views, for range for loops
+    template <bool IsConst>
+    class iterator_base {
+    public:
+        using owner_t = std::conditional_t<IsConst, const WorkerColumns, WorkerColumns>;
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = WorkerView<IsConst>;
+        using difference_type = std::ptrdiff_t;
+
+        iterator_base(owner_t* columns, const size_t index) : owner(columns), i(index) {}
+        WorkerView<IsConst> operator*() const { return (*owner)[i]; }
+        iterator_base& operator++() { ++i; return *this; }
+        bool operator==(const iterator_base& other) const { return i == other.i; }
+        bool operator!=(const iterator_base& other) const { return i != other.i; }
+
+    private:
+        owner_t* owner;
+        size_t i;
+    };
+    using iterator = iterator_base<false>;
+    using const_iterator = iterator_base<true>;
+
+    // Appends a copy of worker, the first worker fixes the number of cues
+    void push_back(const Individual& worker) {
+        if (ids.empty()) num_cues = worker.IndiCues.size();
+        cues.insert(cues.end(), worker.IndiCues.begin(), worker.IndiCues.end());
+        NeutralGene.push_back(worker.NeutralGene);
+        bIsGoing.push_back(worker.bIsGoing);
+        bForage.push_back(worker.bForage);
+        bSuccesfulFood.push_back(worker.bSuccesfulFood);
+        t_birth.push_back(worker.t_birth);
+        t_next.push_back(worker.t_next);
+        ids.push_back(worker.ind_id);
+        nest_ids.push_back(worker.nest_id);
+    }
+
+    void reserve(const size_t n) {
+        cues.reserve(n * num_cues);
+        NeutralGene.reserve(n);
+        bIsGoing.reserve(n);
+        bForage.reserve(n);
+        bSuccesfulFood.reserve(n);
+        t_birth.reserve(n);
+        t_next.reserve(n);
+        ids.reserve(n);
+        nest_ids.reserve(n);
+    }
+
+    size_t size() const { return ids.size(); }
+    bool empty() const { return ids.empty(); }
+
+    WorkerView<false> operator[](const size_t i) {
+        return {CueRowView<double>(cues.data() + i * num_cues, num_cues), NeutralGene[i], bIsGoing[i],
+                bForage[i], bSuccesfulFood[i], t_birth[i], t_next[i], ids[i], nest_ids[i]};
+    }
+
+    WorkerView<true> operator[](const size_t i) const {
+        return {CueRowView<const double>(cues.data() + i * num_cues, num_cues), NeutralGene[i], bIsGoing[i],
+                bForage[i], bSuccesfulFood[i], t_birth[i], t_next[i], ids[i], nest_ids[i]};
+    }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, size()); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+private:
+    size_t num_cues = 0;
+    std::vector<double> cues;                   // Row i holds the cues of worker i
+    std::vector<double> NeutralGene;
+    std::vector<char> bIsGoing;
+    std::vector<char> bForage;
+    std::vector<char> bSuccesfulFood;
+    std::vector<double> t_birth;
+    std::vector<double> t_next;
+    std::vector<int> ids;
+    std::vector<unsigned int> nest_ids;
+};
+
+// Turns worker (an Individual or a WorkerView) into a newborn worker of a nest, in place
+// Same random draws in the same order as the Individual constructor, so a recycled nest
+// (Nest::recycle) gets the workers a newly built one would get, without allocating
+template <typename Worker>
+void renew_worker(Worker&& worker, const int id, const params& p, SimulationContext& ctx, const cue_profile_t& NestMean, const double NestNeutral) {
+    uni_real(ctx.rn);                               // Birth time drawn by the constructor, overwritten there too
+    std::copy(NestMean.begin(), NestMean.end(), worker.IndiCues.begin());
+    worker.NeutralGene = NestNeutral;
+    worker.bIsGoing = true;
+    worker.bForage = false;
+    worker.bSuccesfulFood = false;
+    worker.ind_id = id;
+    mutate_worker(worker, p, ctx);
+    worker.t_birth = ctx.gtime;
+    worker.t_next = worker.t_birth + exponential(ctx.rn, p.dMeanActionTime);
+}
+
+// Worker storage used by Nest, 0 array of structures (default), 1 structure of arrays
+#ifndef WORKER_LAYOUT
+#define WORKER_LAYOUT 0
+#endif
+
+#if WORKER_LAYOUT == 0
+using worker_store_t = std::vector<Individual>;
+#elif WORKER_LAYOUT == 1
+using worker_store_t = WorkerColumns;
+#else
+#error "WORKER_LAYOUT must be 0 (vector of Individual) or 1 (WorkerColumns)"
+#endif
+
+#endif /* Workers_hpp */
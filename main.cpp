@@ -1,20 +1,35 @@
 #include <iostream>
 #include "Population.hpp"
+#include "ThreadPool.hpp"
 #include <iomanip> // For std::setprecision
 #include <sstream> // For std::ostringstream
 
+// Usage: ./myprog [config file] [number of replicates] [number of threads] [master seed] [first replicate]
+// Replicates share the config file and master seed, each draws from its own random stream
+// keyed by (master seed, replicate), so results do not depend on the number of threads
+// and a single replicate k can be re-run with: ./myprog config.ini 1 1 <master seed> k
 int main(int argc, char* argv[]) {
   // Prints parameters values
   try {
-    std::string file_name = (argc > 2) ? argv[1] : "config.ini";
+    std::string file_name = (argc > 1) ? argv[1] : "config.ini";     // A lone config file argument is read too
+    int num_replicates = (argc > 2) ? std::stoi(argv[2]) : 1;
+    int num_threads = (argc > 3) ? std::stoi(argv[3]) : 1;
+    uint64_t master_seed = (argc > 4) ? std::stoull(argv[4]) : make_master_seed();
+    int first_replicate = (argc > 5) ? std::stoi(argv[5]) : 0;
+    if (num_replicates < 1 || num_threads < 1 || first_replicate < 0) {
+      throw std::runtime_error("number of replicates and threads must be positive");
+    }
     std::cout << "Global Parameters:" << std::endl;
-    std::cout << "max_gtime_evolution = " << max_gtime_evolution << std::endl;
-    std::cout << "Pop removal time = " << dRemovalTime << std::endl;
-    std::cout << "Pop recording time = " << dOutputTime << std::endl;
-    std::cout << "Fraction dead nests rec =" << dFracDeadNest << std::endl;
-    std::cout << "Time frac after which counts reset =" << dFracResetSteal << std::endl;
+    SimulationContext ctx(master_seed);
+    std::cout << "max_gtime_evolution = " << ctx.max_gtime_evolution << std::endl;
+    std::cout << "Pop removal time = " << ctx.dRemovalTime << std::endl;
+    std::cout << "Pop recording time = " << ctx.dOutputTime << std::endl;
+    std::cout << "Fraction dead nests rec =" << ctx.dFracDeadNest << std::endl;
+    std::cout << "Time frac after which counts reset =" << ctx.dFracResetSteal << std::endl;
     std::cout << "[dInitIntercept, dInitSlope] = [" << dInitIntercept << " , " << dInitSlope << "]" << std::endl;
-    std::cout << "Coevolving = " << bIsCoevolve << std::endl;
+    std::cout << "Coevolving = " << ctx.bIsCoevolve << std::endl;
+    std::cout << "Replicates = " << num_replicates << " on " << num_threads << " thread(s)" << std::endl;
+    std::cout << "Master seed = " << master_seed << ", first replicate = " << first_replicate << std::endl;
     std::cout << "Reading from config file: " << file_name << "\n";
     std::ifstream test_file(file_name.c_str());
     if (!test_file.is_open()) {
@@ -37,21 +52,55 @@ int main(int argc, char* argv[]) {
 
     params sim_par_in(file_name);
     sim_par_in.print_string_vals();
-    exportParametersToCSV(sim_par_in);
 
     auto start = std::chrono::high_resolution_clock::now();
-    
-    Population myPop(sim_par_in);
-    myPop.initialise_pop();
-
     std::cout << std::fixed;
     std::cout << std::setprecision(2);
-    myPop.simulate(myPop.p.param_names_to_record);
+
+    // Runs one replicate with its own context, so its outputs carry its own simulation ID
+    // A failed replicate is reported and recorded, the remaining replicates still run
+    std::mutex print_mutex;
+    std::vector<int> failed_replicates;
+    auto run_replicate = [&](const int replicate) {
+      SimulationContext rep_ctx(master_seed, replicate);     // Run settings as printed above
+      try {
+        exportParametersToCSV(sim_par_in, rep_ctx);
+        Population myPop(sim_par_in, rep_ctx);
+        myPop.initialise_pop();
+        myPop.simulate(myPop.p.param_names_to_record);
+      } catch (const std::exception& err) {
+        std::lock_guard<std::mutex> lock(print_mutex);
+        std::cerr << "Replicate " << replicate << " (simulation ID " << rep_ctx.simulationID << ") failed: " << err.what() << '\n';
+        std::cerr << "Re-run it with: " << argv[0] << " " << file_name << " 1 1 " << master_seed << " " << replicate << '\n';
+        failed_replicates.push_back(replicate);
+        return;
+      }
+      std::lock_guard<std::mutex> lock(print_mutex);
+      std::cout << "Replicate " << replicate << " done, simulation ID " << rep_ctx.simulationID << std::endl;
+    };
+
+    if (num_threads == 1) {
+      for (int r = first_replicate; r < first_replicate + num_replicates; ++r) run_replicate(r);
+    } else {
+      // Replicates are independent tasks, idle threads steal the ones still queued
+      ThreadPool pool(std::min(num_threads, num_replicates));
+      for (int r = first_replicate; r < first_replicate + num_replicates; ++r) {
+        pool.submit([&run_replicate, r] { run_replicate(r); });
+      }
+      pool.wait();
+    }
 
     auto end = std::chrono::high_resolution_clock::now();
     auto diff = end - start;
     std::cout << std::endl;
     std::cout << "Initial population simulation took " << std::chrono::duration<double>(diff).count() << " seconds" << std::endl;
+    if (!failed_replicates.empty()) {
+      std::sort(failed_replicates.begin(), failed_replicates.end());
+      std::cerr << failed_replicates.size() << " of " << num_replicates << " replicate(s) failed:";
+      for (const int r : failed_replicates) std::cerr << " " << r;
+      std::cerr << '\n';
+      return 1;
+    }
     return 0;
   }
   catch (const std::exception& err) {